@@ -0,0 +1,128 @@
+/**
+ * decsync-glib.vala
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compiled helpers on top of decsync.vapi, built as libdecsync-glib by `make vala`. The async
+// methods use the asynchronous functions of libdecsync.h: the calls run on the worker thread of the
+// instance and the methods resume in the main context in which they were called, so the main loop
+// keeps running during a catch-up. Use [attach_async_source] to also call the listeners in the main
+// context.
+namespace Decsync {
+	// Polling interval of [execute_new_entries_on_change_async] without change notifications
+	private const uint POLL_INTERVAL_SECONDS = 60;
+
+	// The task is completed by the worker thread and resumes the async method in its own context
+	private GLib.Task new_resume_task(owned SourceFunc callback) {
+		return new GLib.Task(null, null, (source_object, result) => {
+			callback();
+		});
+	}
+
+	private void complete_resume_task(void* done_extra) {
+		((GLib.Task) done_extra).return_boolean(true);
+	}
+
+	[CCode (cname = "decsync_vala_set_entries_async", finish_name = "decsync_vala_set_entries_finish")]
+	public async void set_entries_async<T>(Decsync<T> decsync, EntryWithPath[] entries_with_path) {
+		var task = new_resume_task(set_entries_async.callback);
+		decsync.set_entries_with_callback(entries_with_path, complete_resume_task, task);
+		yield;
+	}
+
+	[CCode (cname = "decsync_vala_execute_all_new_entries_async", finish_name = "decsync_vala_execute_all_new_entries_finish")]
+	public async void execute_all_new_entries_async<T>(Decsync<T> decsync, T extra) {
+		var task = new_resume_task(execute_all_new_entries_async.callback);
+		decsync.execute_all_new_entries_with_callback(extra, complete_resume_task, task);
+		yield;
+	}
+
+	[CCode (cname = "decsync_vala_execute_stored_entries_async", finish_name = "decsync_vala_execute_stored_entries_finish")]
+	public async void execute_stored_entries_async<T>(Decsync<T> decsync, StoredEntry[] stored_entries, T extra) {
+		var task = new_resume_task(execute_stored_entries_async.callback);
+		decsync.execute_stored_entries_with_callback(stored_entries, extra, complete_resume_task, task);
+		yield;
+	}
+
+	[CCode (cname = "decsync_vala_execute_all_stored_entries_for_path_prefix_async", finish_name = "decsync_vala_execute_all_stored_entries_for_path_prefix_finish")]
+	public async void execute_all_stored_entries_for_path_prefix_async<T>(Decsync<T> decsync, string[] path, T extra) {
+		var task = new_resume_task(execute_all_stored_entries_for_path_prefix_async.callback);
+		decsync.execute_all_stored_entries_for_path_prefix_with_callback(path, extra, complete_resume_task, task);
+		yield;
+	}
+
+	[CCode (cname = "decsync_vala_init_stored_entries_async", finish_name = "decsync_vala_init_stored_entries_finish")]
+	public async void init_stored_entries_async<T>(Decsync<T> decsync) {
+		var task = new_resume_task(init_stored_entries_async.callback);
+		decsync.init_stored_entries_with_callback(complete_resume_task, task);
+		yield;
+	}
+
+	/**
+	 * Calls the listeners of the asynchronous calls in [context] instead of on the worker thread,
+	 * by dispatching them from a source on the descriptor of decsync_get_async_fd. Destroy the
+	 * returned source before freeing [decsync].
+	 */
+	[CCode (cname = "decsync_vala_attach_async_source")]
+	public GLib.Source attach_async_source<T>(Decsync<T> decsync, GLib.MainContext? context = null) {
+		unowned Decsync<T> instance = decsync;
+		instance.set_async_on_caller_thread(true);
+		var channel = new GLib.IOChannel.unix_new(instance.get_async_fd());
+		var source = new GLib.IOSource(channel, GLib.IOCondition.IN);
+		source.set_callback((ch, cond) => {
+			instance.dispatch_async();
+			return GLib.Source.CONTINUE;
+		});
+		source.attach(context);
+		return source;
+	}
+
+	/**
+	 * Executes the new entries now and every time other apps write new entries, until
+	 * [cancellable] is cancelled. In between, it waits on the descriptor of decsync_get_notify_fd
+	 * in the current main context, so an idle app does not wake up. Without change notifications,
+	 * i.e. on Windows or when inotify is unavailable, it polls every minute instead.
+	 */
+	[CCode (cname = "decsync_vala_execute_new_entries_on_change_async", finish_name = "decsync_vala_execute_new_entries_on_change_finish")]
+	public async void execute_new_entries_on_change_async<T>(Decsync<T> decsync, T extra, GLib.Cancellable? cancellable = null) {
+		var fd = decsync.get_notify_fd();
+		GLib.IOChannel? channel = fd >= 0 ? new GLib.IOChannel.unix_new(fd) : null;
+		while (cancellable == null || !cancellable.is_cancelled()) {
+			// Executing the new entries also resets the descriptor
+			yield execute_all_new_entries_async(decsync, extra);
+			GLib.Source source;
+			if (channel != null) {
+				var io_source = new GLib.IOSource(channel, GLib.IOCondition.IN);
+				io_source.set_callback((ch, cond) => {
+					execute_new_entries_on_change_async.callback();
+					return GLib.Source.REMOVE;
+				});
+				source = io_source;
+			} else {
+				source = new GLib.TimeoutSource.seconds(POLL_INTERVAL_SECONDS);
+				source.set_callback(() => {
+					execute_new_entries_on_change_async.callback();
+					return GLib.Source.REMOVE;
+				});
+			}
+			if (cancellable != null) {
+				source.add_child_source(cancellable.source_new());
+			}
+			source.attach(GLib.MainContext.ref_thread_default());
+			yield;
+		}
+	}
+}
@@ -0,0 +1,38 @@
+/**
+ * libdecsync - DecsyncFlow.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.asFlow
+
+/**
+ * Returns the new entries as a cold [Flow] of batches, see [Decsync.newEntries]. The flow is not
+ * buffered, so the next file is only read once the collector has processed the previous batch.
+ * The files are read in the context of the collector, which should therefore use a dispatcher for
+ * blocking IO.
+ */
+@ExperimentalStdlibApi
+fun <T> Decsync<T>.newEntriesFlow(): Flow<List<Decsync.EntryWithPath>> = newEntries().asFlow()
+
+/**
+ * Returns the stored entries in all paths starting with [prefix] as a cold [Flow], see
+ * [Decsync.storedEntries].
+ */
+@ExperimentalStdlibApi
+fun <T> Decsync<T>.storedEntriesFlow(prefix: List<String>): Flow<Decsync.EntryWithPath> = storedEntries(prefix).asFlow()
@@ -26,6 +26,7 @@ import android.provider.DocumentsContract
 import androidx.annotation.RequiresApi
 import java.io.File
 import java.io.FileOutputStream
+import java.io.InputStream
 
 // Implementations using the Storage Access Framework (SAF)
 
@@ -50,11 +51,11 @@ class RealFileSaf(
 
     override fun length(): Int = length
 
-    override fun read(readBytes: Int): ByteArray {
+    override fun read(readBytes: Int, maxLength: Int): ByteArray {
         val cr = context.contentResolver
         return cr.openInputStream(uri)?.use { input ->
             input.skip(readBytes.toLong())
-            input.readBytes()
+            input.readAtMost(maxLength)
         } ?: throw Exception("Could not open input stream for file $this")
     }
 
@@ -177,10 +178,10 @@ class RealFileSys(
 
     override fun length(): Int = file.length().toInt()
 
-    override fun read(readBytes: Int): ByteArray =
+    override fun read(readBytes: Int, maxLength: Int): ByteArray =
             file.inputStream().use { input ->
                 input.skip(readBytes.toLong())
-                input.readBytes()
+                input.readAtMost(maxLength)
             }
 
     override fun write(text: ByteArray, append: Boolean) =
@@ -234,4 +235,16 @@ private fun realNodeFromFile(file: File, name: String = file.name): RealNode? =
             file.isFile -> RealFileSys(file, name)
             file.isDirectory -> RealDirectorySys(file, name)
             else -> null
-        }
\ No newline at end of file
+        }
+
+private fun InputStream.readAtMost(maxLength: Int): ByteArray {
+    if (maxLength == Int.MAX_VALUE) return readBytes()
+    val buf = ByteArray(maxLength)
+    var size = 0
+    while (size < maxLength) {
+        val n = read(buf, size, maxLength - size)
+        if (n < 0) break
+        size += n
+    }
+    return buf.copyOf(size)
+}
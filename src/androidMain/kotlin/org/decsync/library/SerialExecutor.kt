@@ -0,0 +1,63 @@
+/**
+ * libdecsync - SerialExecutor.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import android.os.AsyncTask
+import java.util.concurrent.locks.ReentrantLock
+import kotlin.concurrent.withLock
+
+internal actual class SerialExecutor actual constructor() {
+    private val lock = ReentrantLock()
+    private val done = lock.newCondition()
+    private val tasks = ArrayDeque<() -> Unit>()
+    private var isActive = false
+
+    actual fun execute(f: () -> Unit) = lock.withLock {
+        tasks.addLast(f)
+        if (!isActive) {
+            isActive = true
+            AsyncTask.THREAD_POOL_EXECUTOR.execute { runTasks() }
+        }
+    }
+
+    private fun runTasks() {
+        while (true) {
+            val task = lock.withLock {
+                tasks.removeFirstOrNull() ?: run {
+                    isActive = false
+                    done.signalAll()
+                    return
+                }
+            }
+            // Also catch errors, as the executor would otherwise stay active and block flush forever
+            try {
+                task()
+            } catch (e: Throwable) {
+                Log.e("Background task failed: ${e.message}")
+            }
+        }
+    }
+
+    actual fun flush() = lock.withLock {
+        while (isActive) {
+            done.await()
+        }
+    }
+}
@@ -18,7 +18,6 @@
 
 package org.decsync.library
 
-import android.os.AsyncTask
 import android.os.Build
 import java.text.DateFormat
 import java.text.SimpleDateFormat
@@ -34,6 +33,4 @@ private val iso8601Format: DateFormat =
         }
 
 @ExperimentalStdlibApi
-actual fun byteArrayToString(input: ByteArray): String = input.decodeToString()
-
-actual fun async(f: () -> Unit) = AsyncTask.execute(f)
\ No newline at end of file
+actual fun byteArrayToString(input: ByteArray): String = input.decodeToString()
\ No newline at end of file
@@ -0,0 +1,44 @@
+/**
+ * libdecsync - WorkerPool.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import java.util.concurrent.ExecutionException
+import java.util.concurrent.Executors
+
+internal actual class WorkerPool actual constructor(actual val size: Int) {
+    private val executor = Executors.newFixedThreadPool(size)
+
+    actual fun runAll(tasks: List<() -> Unit>) {
+        val futures = tasks.map { task -> executor.submit(Runnable { task() }) }
+        var error: Throwable? = null
+        for (future in futures) {
+            try {
+                future.get()
+            } catch (e: ExecutionException) {
+                error = error ?: e.cause
+            }
+        }
+        error?.let { throw it }
+    }
+
+    actual fun close() {
+        executor.shutdown()
+    }
+}
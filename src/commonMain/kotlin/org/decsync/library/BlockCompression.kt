@@ -0,0 +1,161 @@
+/**
+ * libdecsync - BlockCompression.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+/**
+ * Byte-oriented LZ77 compression of a block, in the spirit of LZ4. It only needs to be fast and to
+ * work on every platform, which rules out the system zlib. The lines of DecSync files are very
+ * repetitive (datetimes, keys and values), so back-references alone already give a good ratio.
+ *
+ * A block is a sequence of items, each consisting of
+ * - a token byte with the number of literals in the high and the match length minus
+ *   [MIN_MATCH] in the low nibble,
+ * - the remainder of the literal count if the nibble is 15, as bytes of 255 and a final byte,
+ * - the literals,
+ * - the match offset as 2 little-endian bytes,
+ * - the remainder of the match length, encoded like the literal count.
+ * The last item stops after its literals.
+ */
+internal object BlockCompression {
+    private const val MIN_MATCH = 4
+    private const val MAX_OFFSET = 0xffff
+    private const val HASH_BITS = 14
+
+    fun compress(input: ByteArray): ByteArray {
+        val output = ByteBuilder(input.size / 2 + 16)
+        val table = IntArray(1 shl HASH_BITS) { -1 }
+        var anchor = 0
+        var pos = 0
+        while (pos + MIN_MATCH <= input.size) {
+            val sequence = readInt(input, pos)
+            val hash = (sequence * -1640531535) ushr (32 - HASH_BITS)
+            val candidate = table[hash]
+            table[hash] = pos
+            if (candidate < 0 || pos - candidate > MAX_OFFSET || readInt(input, candidate) != sequence) {
+                pos++
+                continue
+            }
+            var length = MIN_MATCH
+            while (pos + length < input.size && input[candidate + length] == input[pos + length]) {
+                length++
+            }
+            writeItem(output, input, anchor, pos, pos - candidate, length)
+            pos += length
+            anchor = pos
+        }
+        writeItem(output, input, anchor, input.size, 0, 0)
+        return output.toByteArray()
+    }
+
+    fun decompress(input: ByteArray, size: Int): ByteArray {
+        val output = ByteArray(size)
+        var i = 0
+        var o = 0
+        while (true) {
+            val token = input[i++].toInt() and 0xff
+            var literals = token ushr 4
+            if (literals == 15) {
+                do {
+                    val b = input[i++].toInt() and 0xff
+                    literals += b
+                } while (b == 0xff)
+            }
+            input.copyInto(output, o, i, i + literals)
+            i += literals
+            o += literals
+            if (i == input.size) break
+
+            val offset = (input[i].toInt() and 0xff) or ((input[i + 1].toInt() and 0xff) shl 8)
+            i += 2
+            var length = token and 0xf
+            if (length == 15) {
+                do {
+                    val b = input[i++].toInt() and 0xff
+                    length += b
+                } while (b == 0xff)
+            }
+            length += MIN_MATCH
+            if (offset == 0 || offset > o) throw Exception("Invalid offset $offset in compressed block")
+            // The match may overlap the bytes it produces, so it is copied byte by byte
+            var from = o - offset
+            repeat(length) { output[o++] = output[from++] }
+        }
+        if (o != size) throw Exception("Compressed block has size $o instead of $size")
+        return output
+    }
+
+    private fun writeItem(output: ByteBuilder, input: ByteArray, start: Int, end: Int, offset: Int, length: Int) {
+        val literals = end - start
+        val matchNibble = if (length == 0) 0 else minOf(length - MIN_MATCH, 15)
+        output.add((minOf(literals, 15) shl 4) or matchNibble)
+        if (literals >= 15) writeLength(output, literals - 15)
+        output.add(input, start, end)
+        if (length == 0) return
+        output.add(offset and 0xff)
+        output.add(offset ushr 8)
+        if (length - MIN_MATCH >= 15) writeLength(output, length - MIN_MATCH - 15)
+    }
+
+    private fun writeLength(output: ByteBuilder, remainder: Int) {
+        var left = remainder
+        while (left >= 0xff) {
+            output.add(0xff)
+            left -= 0xff
+        }
+        output.add(left)
+    }
+
+    private fun readInt(input: ByteArray, pos: Int): Int =
+            (input[pos].toInt() and 0xff) or
+                    ((input[pos + 1].toInt() and 0xff) shl 8) or
+                    ((input[pos + 2].toInt() and 0xff) shl 16) or
+                    (input[pos + 3].toInt() shl 24)
+}
+
+/**
+ * Growable byte array, like a [StringBuilder] for bytes.
+ */
+internal class ByteBuilder(capacity: Int = 64) {
+    private var bytes = ByteArray(maxOf(capacity, 16))
+    var size = 0
+        private set
+
+    fun add(byte: Int) {
+        ensureCapacity(size + 1)
+        bytes[size++] = byte.toByte()
+    }
+
+    fun add(input: ByteArray, start: Int = 0, end: Int = input.size) {
+        ensureCapacity(size + end - start)
+        input.copyInto(bytes, size, start, end)
+        size += end - start
+    }
+
+    fun clear() {
+        size = 0
+    }
+
+    fun toByteArray(): ByteArray = bytes.copyOf(size)
+
+    private fun ensureCapacity(capacity: Int) {
+        if (capacity > bytes.size) {
+            bytes = bytes.copyOf(maxOf(capacity, 2 * bytes.size))
+        }
+    }
+}
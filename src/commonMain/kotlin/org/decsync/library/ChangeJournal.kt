@@ -0,0 +1,106 @@
+/**
+ * libdecsync - ChangeJournal.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlinx.serialization.json.JsonArray
+import kotlinx.serialization.json.JsonPrimitive
+import kotlin.random.Random
+
+// A watermark consists of the generation of the journal in the high bits and the offset in the
+// journal in the low bits
+private const val OFFSET_BITS = 40
+private const val OFFSET_MASK = (1L shl OFFSET_BITS) - 1
+// The journal is started again in a new generation when it grows past this size
+private const val MAX_SIZE = 16 shl 20
+
+/**
+ * Append-only journal of the entries which are stored by an app, kept in its local directory. A
+ * position in the journal is a watermark: the entries stored after it are read from that position
+ * on, without scanning the stored entries.
+ *
+ * The journal is opt-in: nothing is appended until the first [watermark] starts it, so apps which
+ * never ask for changes do not pay for it. It is started by writing a random generation to
+ * [generationFile], which is part of the watermark. A journal which is removed or grows past
+ * [MAX_SIZE] is started again in a new generation, so the watermarks of the old journal are
+ * detected as stale.
+ */
+@ExperimentalStdlibApi
+internal class ChangeJournal(private val file: DecsyncFile, private val generationFile: DecsyncFile) {
+    fun append(path: List<String>, entries: Collection<Decsync.Entry>) {
+        if (entries.isEmpty() || !isStarted()) return
+        if (file.length() > MAX_SIZE) {
+            restart()
+        }
+        val pathText = JsonArray(path.map { JsonPrimitive(it) }).toString()
+        val lines = entries.map { entry ->
+            "[$pathText,${JsonPrimitive(entry.datetime)},${entry.keyText.text},${entry.valueText.text}]"
+        }
+        file.writeLines(lines, true)
+    }
+
+    /**
+     * Returns the watermark of the end of the journal. The first call starts the journal, so it
+     * must not run in parallel with other calls.
+     */
+    fun watermark(): Long {
+        if (!isStarted()) {
+            restart()
+        }
+        return watermark(generation(), file.length())
+    }
+
+    /**
+     * Returns the entries stored after [watermark] and the new watermark. Only the latest entry of
+     * every path and key is returned. A watermark of another generation or past the end of the
+     * journal is stale: then no entries are returned, as the changes since are unknown. If the
+     * journal is not started, the returned watermark is -1 as well.
+     */
+    fun readSince(watermark: Long): Decsync.Changes {
+        if (!isStarted()) return Decsync.Changes(emptyList(), -1, true)
+        val generation = generation()
+        val size = file.length()
+        val offset = watermark and OFFSET_MASK
+        if (watermark < 0 || (watermark ushr OFFSET_BITS).toInt() != generation || offset > size) {
+            return Decsync.Changes(emptyList(), watermark(generation, size), true)
+        }
+        if (offset == size.toLong()) return Decsync.Changes(emptyList(), watermark)
+        val latestEntries = LinkedHashMap<Pair<List<String>, JsonText>, Decsync.EntryWithPath>()
+        for (line in file.readLines(offset.toInt())) {
+            val entryWithPath = Decsync.EntryWithPath.fromLine(line) ?: continue
+            val key = Pair(entryWithPath.path, entryWithPath.entry.keyText)
+            // Move a changed key to the end, such that the entries stay in the order of storing
+            latestEntries.remove(key)
+            latestEntries[key] = entryWithPath
+        }
+        return Decsync.Changes(latestEntries.values.toList(), watermark(generation, size))
+    }
+
+    private fun watermark(generation: Int, offset: Int): Long =
+            (generation.toLong() shl OFFSET_BITS) or offset.toLong()
+
+    private fun generation(): Int = generationFile.readText()?.toIntOrNull() ?: 0
+
+    private fun isStarted(): Boolean = generationFile.file.fileSystemNode is RealFile
+
+    // Removes the old journal, including one left without a generation, and starts a new generation
+    private fun restart() {
+        file.writeLines(emptyList())
+        generationFile.writeText(Random.nextInt(1, 1 shl 23).toString())
+    }
+}
@@ -105,7 +105,8 @@ class Decsync<T> internal constructor(
         private val localDir: DecsyncFile,
         private val syncType: String,
         private val collection: String?,
-        private val ownAppId: String
+        private val ownAppId: String,
+        sharedDecsyncInfo: JsonObject? = null
 ) {
     private val localInfo: MutableMap<String, JsonElement> = getLocalInfo()
     private fun getLocalInfo(): MutableMap<String, JsonElement> {
@@ -118,10 +119,11 @@ class Decsync<T> internal constructor(
     }
     private var version: DecsyncVersion
     private var instance: DecsyncInst<T>
+    private val executor = SerialExecutor()
     var isInInit = false
 
     init {
-        val decsyncInfo = getDecsyncInfoOrDefault(decsyncDir)
+        val decsyncInfo = sharedDecsyncInfo ?: getDecsyncInfoOrDefault(decsyncDir)
         val decsyncVersion = getDecsyncVersion(decsyncInfo)!! // Also checks whether we support the main DecSync version
         val localVersion = getDecsyncVersion(localInfo) // Caches getLatestOwnDecsyncVersion
         if (localVersion != null) {
@@ -223,16 +225,41 @@ class Decsync<T> internal constructor(
         }
     }
 
+    /**
+     * Entries stored since a watermark, together with the new watermark. If [isStale] is set, the
+     * old watermark belongs to a journal which was removed or started again, and the changes since
+     * are unknown. See [changesSince].
+     */
+    data class Changes(val entries: List<EntryWithPath>, val watermark: Long, val isStale: Boolean = false)
+
     /**
      * Represents a key/value pair stored by DecSync. Additionally, it has a datetime property
      * indicating the most recent update. It does not store its path, see [EntryWithPath].
+     *
+     * The key and value are kept as JSON text and are only parsed when [key] or [value] is used.
      */
-    data class Entry(val datetime: String, val key: JsonElement, val value: JsonElement) {
+    class Entry internal constructor(
+            val datetime: String,
+            internal val keyText: JsonText,
+            internal val valueText: JsonText
+    ) {
+        constructor(datetime: String, key: JsonElement, value: JsonElement) : this(datetime, JsonText(key), JsonText(value))
+
         /**
          * Convenience constructor which sets the [datetime] property to the current datetime.
          */
         constructor(key: JsonElement, value: JsonElement) : this(currentDatetime(), key, value)
 
+        val key: JsonElement get() = keyText.element
+        val value: JsonElement get() = valueText.element
+
+        operator fun component1(): String = datetime
+        operator fun component2(): JsonElement = key
+        operator fun component3(): JsonElement = value
+
+        fun copy(datetime: String = this.datetime, key: JsonElement = this.key, value: JsonElement = this.value): Entry =
+                Entry(datetime, key, value)
+
         internal fun toJson(): JsonElement {
             return buildJsonArray {
                 add(datetime)
@@ -241,23 +268,47 @@ class Decsync<T> internal constructor(
             }
         }
 
-        override fun toString(): String = toJson().toString()
+        internal fun toLine(): String = "[${JsonPrimitive(datetime)},${keyText.text},${valueText.text}]"
+
+        override fun equals(other: Any?): Boolean {
+            if (other === this) return true
+            if (other == null || other !is Entry) return false
+            return datetime == other.datetime && keyText == other.keyText && valueText == other.valueText
+        }
+
+        override fun hashCode(): Int = (datetime.hashCode() * 31 + keyText.hashCode()) * 31 + valueText.hashCode()
+
+        override fun toString(): String = toLine()
 
         companion object {
-            internal fun fromLine(line: String): Entry? =
-                    try {
-                        val array = json.parseToJsonElement(line).jsonArray
-                        if (array.size != 3) throw Exception("Size of array not 3")
-                        val datetime = array[0].jsonPrimitive.content
-                        val key = array[1]
-                        val value = array[2]
-                        Entry(datetime, key, value)
-                    } catch (e: Exception) {
-                        Log.e("Invalid entry: $line")
-                        Log.e(e.message!!)
-                        null
-                    }
+            /**
+             * Creates an entry with the current datetime from the JSON-serialized [key] and
+             * [value]. The texts are only parsed when they are not canonical.
+             */
+            internal fun fromText(key: String, value: String): Entry =
+                    Entry(currentDatetime(), JsonText.fromText(key), JsonText.fromText(value))
+
+            internal fun fromLine(line: String): Entry? {
+                // Fast path: canonical lines are split without building the elements
+                JsonText.splitArray(line)?.let { items ->
+                    if (items.size != 3) return@let
+                    val datetime = items[0].stringContent() ?: return@let
+                    return Entry(datetime, items[1], items[2])
+                }
+                return try {
+                    val array = json.parseToJsonElement(line).jsonArray
+                    if (array.size != 3) throw Exception("Size of array not 3")
+                    val datetime = array[0].jsonPrimitive.content
+                    val key = array[1]
+                    val value = array[2]
+                    Entry(datetime, key, value)
+                } catch (e: Exception) {
+                    Log.e("Invalid entry: $line")
+                    Log.e(e.message!!)
+                    null
+                }
             }
+        }
     }
 
     /**
@@ -311,7 +362,10 @@ class Decsync<T> internal constructor(
      * @param extra extra userdata passed to the [listeners].
      * @param disableMaintenance do not execute an upgrade in this call.
      */
-    fun executeAllNewEntries(extra: T, disableMaintenance: Boolean = false) {
+    fun executeAllNewEntries(extra: T, disableMaintenance: Boolean = false) =
+            executeAllNewEntries(extra, disableMaintenance, null)
+
+    internal fun executeAllNewEntries(extra: T, disableMaintenance: Boolean, sharedDecsyncInfo: JsonObject?) {
         if (isInInit) {
             Log.d("executeAllNewEntries called while in init")
             return
@@ -320,46 +374,137 @@ class Decsync<T> internal constructor(
         instance.executeAllNewEntries(WithExtra(extra))
 
         if (!disableMaintenance) {
-            val oldVersion = version
-            val decsyncInfo = getDecsyncInfoOrDefault(decsyncDir)
-            val newVersion = getDecsyncVersion(decsyncInfo)!!
-            if (oldVersion < newVersion) {
-                Log.d("Upgrading from DecSync version $oldVersion to $newVersion")
-                val oldDecsync = getInstance<MutableList<EntryWithPath>>(oldVersion)
-                val newDecsync = getInstance<T>(newVersion)
-                newDecsync.listeners.addAll(instance.listeners)
-                upgrade(oldDecsync, newDecsync)
-                localInfo["version"] = JsonPrimitive(newVersion.toInt())
-                writeLocalInfo()
-                version = newVersion
-                instance = newDecsync
-
-                // Also get the updates in the new DecSync version
-                instance.executeAllNewEntries(WithExtra(extra))
-            }
+            doMaintenance(extra, sharedDecsyncInfo)
+        }
+    }
 
-            val lastActive = localInfo["last-active"]?.jsonPrimitive?.content
-            val currentDate = currentDatetime().take(10) // YYYY-MM-DD
-            if (lastActive == null || currentDate > lastActive) {
-                localInfo["last-active"] = JsonPrimitive(currentDate)
-                writeLocalInfo()
-                setEntry(listOf("info"), JsonPrimitive("last-active-$ownAppId"), JsonPrimitive(currentDate))
-            }
+    /**
+     * Variant of [executeAllNewEntries] for callers which call the listeners of the batches
+     * themselves, e.g. on another thread, using [executeBatch]. A batch is stored once the next
+     * batch is requested, and the maintenance work is done at the end of the sequence.
+     */
+    internal fun newEntryBatches(extra: T): Sequence<DecsyncInst.NewEntriesBatch> = sequence {
+        if (isInInit) {
+            Log.d("newEntryBatches called while in init")
+            return@sequence
+        }
+        Log.d("Execute all new entries in batches")
+        yieldAll(instance.newEntryBatches())
+        doMaintenance(extra, null)
+    }
 
-            val supportedVersion = localInfo["supported-version"]?.jsonPrimitive?.int
-            if (supportedVersion == null || SUPPORTED_VERSION > supportedVersion) {
-                localInfo["supported-version"] = JsonPrimitive(SUPPORTED_VERSION)
-                writeLocalInfo()
-                setEntry(listOf("info"), JsonPrimitive("supported-version-$ownAppId"), JsonPrimitive(SUPPORTED_VERSION))
-            }
+    internal fun executeBatch(batch: DecsyncInst.NewEntriesBatch, extra: T) {
+        batch.success = instance.callListener(batch.path, batch.entries, extra)
+    }
+
+    private fun doMaintenance(extra: T, sharedDecsyncInfo: JsonObject?) {
+        val oldVersion = version
+        val decsyncInfo = sharedDecsyncInfo ?: getDecsyncInfoOrDefault(decsyncDir)
+        val newVersion = getDecsyncVersion(decsyncInfo)!!
+        if (oldVersion < newVersion) {
+            Log.d("Upgrading from DecSync version $oldVersion to $newVersion")
+            val oldDecsync = getInstance<MutableList<EntryWithPath>>(oldVersion)
+            val newDecsync = getInstance<T>(newVersion)
+            newDecsync.listeners.addAll(instance.listeners)
+            upgrade(oldDecsync, newDecsync)
+            localInfo["version"] = JsonPrimitive(newVersion.toInt())
+            writeLocalInfo()
+            version = newVersion
+            instance = newDecsync
+
+            // Also get the updates in the new DecSync version
+            instance.executeAllNewEntries(WithExtra(extra))
+        }
+
+        updateActivity()
+    }
+
+    private fun updateActivity() {
+        val lastActive = localInfo["last-active"]?.jsonPrimitive?.content
+        val currentDate = currentDatetime().take(10) // YYYY-MM-DD
+        if (lastActive == null || currentDate > lastActive) {
+            localInfo["last-active"] = JsonPrimitive(currentDate)
+            writeLocalInfo()
+            setEntry(listOf("info"), JsonPrimitive("last-active-$ownAppId"), JsonPrimitive(currentDate))
+        }
+
+        val supportedVersion = localInfo["supported-version"]?.jsonPrimitive?.int
+        if (supportedVersion == null || SUPPORTED_VERSION > supportedVersion) {
+            localInfo["supported-version"] = JsonPrimitive(SUPPORTED_VERSION)
+            writeLocalInfo()
+            setEntry(listOf("info"), JsonPrimitive("supported-version-$ownAppId"), JsonPrimitive(SUPPORTED_VERSION))
+        }
+    }
+
+    /**
+     * Pull-based variant of [executeAllNewEntries]: returns the new entries of the other apps as a
+     * lazy sequence of batches, without calling the listeners. Every batch contains the entries of
+     * one path written by one app. Only one file is read at a time, so the memory usage stays
+     * constant during a large catch-up.
+     *
+     * A batch is stored as executed once the next batch is requested. When the iteration is
+     * stopped early, the last returned batch is returned again by the next call. Upgrades of the
+     * DecSync version are only done by [executeAllNewEntries]. The sequence can be iterated once
+     * and no other methods of this instance may be called during the iteration.
+     */
+    fun newEntries(): Sequence<List<EntryWithPath>> = sequence {
+        if (isInInit) {
+            Log.d("newEntries called while in init")
+            return@sequence
         }
+        Log.d("Stream all new entries")
+        for (batch in instance.newEntryBatches()) {
+            batch.entries.removeAll { DecsyncInst.isInternalEntry(batch.path, it) }
+            if (batch.entries.isEmpty()) continue
+            yield(batch.entries.map { EntryWithPath(batch.path, it) })
+        }
+        updateActivity()
+    }
+
+    /**
+     * Returns the entries which are stored after [watermark], both the ones written by this app and
+     * the ones executed from other apps, together with the new watermark. Only the latest entry of
+     * every path and key is returned, in the order of storing. The changes are read from a local
+     * journal which is appended when entries are stored, so no stored entries are scanned.
+     *
+     * The watermark is an opaque position in the journal. The journal is only kept once the app
+     * takes its first [currentChangesWatermark] and only contains the entries stored since, so a new
+     * consumer takes the [currentChangesWatermark] and then reads all [storedEntries] once. The same
+     * holds when [Changes.isStale] is set: the journal was removed or started again, so the consumer
+     * takes a new [currentChangesWatermark] and reads all stored entries again.
+     *
+     * @param watermark the watermark returned by the previous call.
+     */
+    fun changesSince(watermark: Long): Changes {
+        Log.d("Get changes since $watermark")
+        val changes = instance.changeJournal.readSince(watermark)
+        val entries = changes.entries.filter { !DecsyncInst.isInternalEntry(it.path, it.entry) }
+        return Changes(entries, changes.watermark, changes.isStale)
+    }
+
+    /**
+     * Returns the watermark of the end of the change journal. The first call starts the journal.
+     * See [changesSince].
+     */
+    fun currentChangesWatermark(): Long = instance.changeJournal.watermark()
+
+    /**
+     * Returns the stored entries in all paths starting with [prefix] as a lazy sequence, in path
+     * order. See [openStoredEntriesCursor].
+     */
+    fun storedEntries(prefix: List<String>): Sequence<EntryWithPath> {
+        Log.d("Stream stored entries of prefix $prefix")
+        return instance.storedEntries(prefix)
     }
 
     /**
      * Gets the stored entry in [path] with key [key] and executes the corresponding action, passing
      * extra data [extra] to the listener.
      */
-    fun executeStoredEntry(path: List<String>, key: JsonElement, extra: T): Boolean {
+    fun executeStoredEntry(path: List<String>, key: JsonElement, extra: T): Boolean =
+            executeStoredEntry(path, JsonText(key), extra)
+
+    internal fun executeStoredEntry(path: List<String>, key: JsonText, extra: T): Boolean {
         Log.d("Execute 1 stored entry")
         return instance.executeStoredEntry(path, key, extra)
     }
@@ -390,7 +535,12 @@ class Decsync<T> internal constructor(
             path: List<String>,
             extra: T,
             keys: List<JsonElement>? = null
-    ): Boolean {
+    ): Boolean = executeStoredEntriesForPathExactTexts(path, extra, keys?.map { JsonText(it) })
+
+    internal fun executeStoredEntriesForPathExact(path: List<String>, extra: T, keys: List<JsonText>): Boolean =
+            executeStoredEntriesForPathExactTexts(path, extra, keys)
+
+    private fun executeStoredEntriesForPathExactTexts(path: List<String>, extra: T, keys: List<JsonText>?): Boolean {
         Log.d("Execute stored entries of path $path")
         return instance.executeStoredEntriesForPathExact(path, extra, keys)
     }
@@ -408,11 +558,29 @@ class Decsync<T> internal constructor(
             prefix: List<String>,
             extra: T,
             keys: List<JsonElement>? = null
-    ): Boolean {
+    ): Boolean = executeStoredEntriesForPathPrefixTexts(prefix, extra, keys?.map { JsonText(it) })
+
+    internal fun executeStoredEntriesForPathPrefix(prefix: List<String>, extra: T, keys: List<JsonText>): Boolean =
+            executeStoredEntriesForPathPrefixTexts(prefix, extra, keys)
+
+    private fun executeStoredEntriesForPathPrefixTexts(prefix: List<String>, extra: T, keys: List<JsonText>?): Boolean {
         Log.d("Execute stored entries of prefix $prefix")
         return instance.executeStoredEntriesForPathPrefix(prefix, extra, keys)
     }
 
+    /**
+     * Opens a cursor over the stored entries of this app in all paths starting with [prefix]. The
+     * entries are returned in path order and read one file at a time, so the memory usage does not
+     * grow with the number of stored entries. Unlike the execute methods, no listeners are called
+     * and the reading can be stopped at any point.
+     *
+     * @param prefix path prefix of the entries to return.
+     */
+    fun openStoredEntriesCursor(prefix: List<String>): StoredEntriesCursor {
+        Log.d("Open stored entries cursor of prefix $prefix")
+        return StoredEntriesCursor(instance.storedEntries(prefix))
+    }
+
     /**
      * Initializes the stored entries. This method does not execute any actions. This is often
      * followed with a call to [executeStoredEntries].
@@ -424,6 +592,12 @@ class Decsync<T> internal constructor(
         isInInit = false
     }
 
+    /**
+     * Waits until the background work of this instance is completed, like deleting the files of an
+     * old DecSync version after an upgrade.
+     */
+    fun flush() = executor.flush()
+
     /**
      * Returns the most up-to-date appId. This is the appId which has stored the most recent entry.
      * In case of a tie, the appId corresponding to the current application is used, if possible.
@@ -454,7 +628,7 @@ class Decsync<T> internal constructor(
         newDecsync.setEntries(entriesWithPath)
 
         // Delete old entries
-        async {
+        executor.execute {
             oldDecsync.deleteOwnEntries()
         }
     }
@@ -513,6 +687,30 @@ class Decsync<T> internal constructor(
             val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
             dir.delete()
         }
+
+        /**
+         * Exports the collection [collection] of [syncType] to the single file [archive], which is
+         * compressed and can be copied much faster than the individual files. If [appId] is
+         * given, only the data of that app and the shared info is exported. Machine-local caches
+         * are left out. An archive which would exceed 2 GiB fails instead of being written.
+         */
+        fun exportArchive(decsyncDir: NativeFile, syncType: String, collection: String?,
+                          archive: NativeFile, appId: String? = null) {
+            Log.d("Export $syncType/$collection in $decsyncDir to $archive")
+            val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+            DecsyncArchive.export(dir.file, archive, appId)
+        }
+
+        /**
+         * Restores an [archive] made by [exportArchive] into the collection [collection] of
+         * [syncType]. Existing files which are also in the archive are overwritten.
+         */
+        fun importArchive(decsyncDir: NativeFile, syncType: String, collection: String?, archive: NativeFile) {
+            Log.d("Import $archive to $syncType/$collection in $decsyncDir")
+            checkDecsyncInfo(decsyncDir)
+            val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+            DecsyncArchive.import(dir.file, archive)
+        }
     }
 }
 
@@ -629,16 +827,33 @@ internal abstract class DecsyncInst<T> {
 
     abstract fun setEntriesForPath(path: List<String>, entries: List<Decsync.Entry>)
 
-    abstract fun executeAllNewEntries(optExtra: OptExtra<T>)
+    /**
+     * Entries of one new-entries file which are newer than the stored ones. The consumer of the
+     * batch can remove entries which are not processed and set [success] to false, in which case
+     * the file is read again the next time. If entries may have been stored in the meantime, the
+     * consumer sets [recheck], such that the entries are compared with the stored ones again.
+     */
+    class NewEntriesBatch(val path: List<String>, val entries: MutableList<Decsync.Entry>) {
+        var success = true
+        var recheck = false
+    }
+
+    /**
+     * Returns the batches of new entries of the other apps. The batches are read lazily, one file
+     * at a time, and a batch is only stored once the next batch is requested.
+     */
+    abstract fun newEntryBatches(): Sequence<NewEntriesBatch>
 
-    open fun callListener(path: List<String>, entries: MutableList<Decsync.Entry>, extra: T): Boolean {
-        entries.removeAll {
-            path == listOf("info") &&
-                    it.key is JsonPrimitive &&
-                    it.key.isString &&
-                    (it.key.content.startsWith("last-active-") ||
-                            it.key.content.startsWith("supported-version-"))
+    fun executeAllNewEntries(optExtra: OptExtra<T>) {
+        for (batch in newEntryBatches()) {
+            if (optExtra is WithExtra) {
+                batch.success = callListener(batch.path, batch.entries, optExtra.value)
+            }
         }
+    }
+
+    open fun callListener(path: List<String>, entries: MutableList<Decsync.Entry>, extra: T): Boolean {
+        entries.removeAll { isInternalEntry(path, it) }
         if (entries.isEmpty()) return true
         val listener = listeners.firstOrNull { it.matchesPath(path) } ?: run {
             Log.e("Unknown action for path $path")
@@ -647,12 +862,12 @@ internal abstract class DecsyncInst<T> {
         return listener.onEntriesUpdate(path, entries, extra)
     }
 
-    open fun executeStoredEntry(path: List<String>, key: JsonElement, extra: T): Boolean =
+    open fun executeStoredEntry(path: List<String>, key: JsonText, extra: T): Boolean =
             executeStoredEntriesForPathExact(path, extra, listOf(key))
 
     open fun executeStoredEntries(storedEntries: List<Decsync.StoredEntry>, extra: T): Boolean {
         var allSuccess = true
-        storedEntries.groupBy({ it.path }, { it.key }).forEach { (path, keys) ->
+        storedEntries.groupBy({ it.path }, { JsonText(it.key) }).forEach { (path, keys) ->
             val success = executeStoredEntriesForPathExact(path, extra, keys)
             allSuccess = allSuccess && success
         }
@@ -662,12 +877,22 @@ internal abstract class DecsyncInst<T> {
     abstract fun executeStoredEntriesForPathExact(
             path: List<String>,
             extra: T,
-            keys: List<JsonElement>? = null): Boolean
+            keys: List<JsonText>? = null): Boolean
 
     abstract fun executeStoredEntriesForPathPrefix(
             prefix: List<String>,
             extra: T,
-            keys: List<JsonElement>? = null): Boolean
+            keys: List<JsonText>? = null): Boolean
+
+    /**
+     * Returns the stored entries of this app in all paths starting with [prefix], in path order.
+     * The entries are read lazily, one file at a time.
+     */
+    abstract fun storedEntries(prefix: List<String>): Sequence<Decsync.EntryWithPath>
+
+    val changeJournal by lazy {
+        ChangeJournal(localDir.child("change-journal"), localDir.child("change-journal-generation"))
+    }
 
     abstract fun latestAppId(): String
 
@@ -678,6 +903,14 @@ internal abstract class DecsyncInst<T> {
     }
 
     companion object {
+        // Info entries which are maintained by the library itself and not passed to the listeners
+        fun isInternalEntry(path: List<String>, entry: Decsync.Entry): Boolean =
+                path == listOf("info") &&
+                        entry.key is JsonPrimitive &&
+                        entry.key.isString &&
+                        (entry.key.content.startsWith("last-active-") ||
+                                entry.key.content.startsWith("supported-version-"))
+
         fun deleteSubdir(subdir: DecsyncFile, appId: String) {
             subdir.child(appId).delete()
             if (subdir.listDirectories().isEmpty()) {
@@ -711,13 +944,24 @@ private val defaultDecsyncInfo: JsonObject = buildJsonObject {
 }
 
 @ExperimentalStdlibApi
-private fun getDecsyncInfoOrDefault(decsyncDir: NativeFile): JsonObject =
+internal fun getDecsyncInfoOrDefault(decsyncDir: NativeFile): JsonObject =
         try {
             getDecsyncInfo(decsyncDir) ?: defaultDecsyncInfo.also { setDecsyncInfo(decsyncDir, it) }
         } catch (e: Exception) {
             throw getInvalidInfoException(e)
         }
 
+// Like getDecsyncInfoOrDefault, but never writes a default .decsync-info file
+@ExperimentalStdlibApi
+internal fun getDecsyncVersionReadOnly(decsyncDir: NativeFile): DecsyncVersion {
+    val info = try {
+        getDecsyncInfo(decsyncDir) ?: defaultDecsyncInfo
+    } catch (e: Exception) {
+        throw getInvalidInfoException(e)
+    }
+    return getDecsyncVersion(info)!!
+}
+
 @ExperimentalStdlibApi
 private fun getDecsyncVersion(info: Map<String, JsonElement>): DecsyncVersion? {
     val version = try {
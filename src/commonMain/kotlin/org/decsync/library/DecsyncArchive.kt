@@ -0,0 +1,209 @@
+/**
+ * libdecsync - DecsyncArchive.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlinx.serialization.json.*
+
+/**
+ * Packs the files of a collection into a single archive, which is much faster to copy than the
+ * many small files on network and FUSE file systems. The archive consists of
+ * - the magic bytes [MAGIC] and the format version,
+ * - blocks with the contents of multiple files, compressed by [BlockCompression],
+ * - an index block with a line `[blockOffset,offsetInBlock,length,"relative/path"]` per file,
+ * - the offset of the index block and the magic bytes again.
+ * A file is never split over blocks, so the files of a block are restored together. The paths use
+ * the encoded names on disk and include hidden files, like the sequence numbers. The caches in the
+ * local directory are left out, as they only apply to the current machine.
+ *
+ * All offsets are 32-bit, like the file offsets of [NativeFile], so an archive is at most 2 GiB.
+ */
+@ExperimentalStdlibApi
+internal object DecsyncArchive {
+    private val MAGIC = "DSAR".encodeToByteArray()
+    private const val VERSION = 1
+    private const val BLOCK_SIZE = 1 shl 20
+    // Directories whose children are named after the owning appId
+    private val APP_DIRS = listOf("new-entries", "stored-entries", "read-bytes", "local", "info")
+    // Machine-local caches: the directory cache of the native instances and the change journals
+    private const val DIRECTORY_CACHE = ".decsync-cache"
+    private val LOCAL_CACHES = listOf("change-journal", "change-journal-generation")
+
+    private class IndexEntry(val blockOffset: Int, val offset: Int, val length: Int, val path: String)
+
+    /**
+     * Writes the files of the collection directory [dir] to [archive], replacing any existing file.
+     * If [appId] is given, only the data of that app and the shared files are included.
+     */
+    fun export(dir: NativeFile, archive: NativeFile, appId: String?) {
+        archive.write(ByteArray(0))
+        val appDirName = appId?.let { Url.encode(it) }
+        val include = { path: List<String> ->
+            !(appDirName != null && path.size >= 2 && path[0] in APP_DIRS && path[1] != appDirName) &&
+                    !(path.size == 2 && path[0] == "local" && path[1] == DIRECTORY_CACHE) &&
+                    !(path.size == 3 && path[0] == "local" && path[2] in LOCAL_CACHES)
+        }
+        try {
+            val writer = Writer(archive)
+            forEachFile(dir, emptyList(), include) { path, content ->
+                writer.add(path.joinToString("/"), content)
+            }
+            writer.finish()
+        } catch (e: Exception) {
+            // Do not leave a partial archive behind
+            archive.write(ByteArray(0))
+            throw e
+        }
+    }
+
+    /**
+     * Restores the files of [archive] in the collection directory [dir], overwriting existing
+     * files with the same path. Only the header, the footer and the index are read first, after
+     * which the archive is read one block at a time.
+     */
+    fun import(dir: NativeFile, archive: NativeFile) {
+        if (archive.fileSystemNode !is RealFile) throw Exception("Archive $archive does not exist")
+        val size = archive.length()
+        val headerSize = MAGIC.size + 1
+        val footerSize = 4 + MAGIC.size
+        if (size < headerSize + footerSize) throw Exception("Invalid archive $archive")
+        val header = readRange(archive, 0, headerSize)
+        val footer = readRange(archive, size - footerSize, footerSize)
+        if (!header.copyOf(MAGIC.size).contentEquals(MAGIC) ||
+                !footer.copyOfRange(4, footerSize).contentEquals(MAGIC)) {
+            throw Exception("Invalid archive $archive")
+        }
+        val version = header[MAGIC.size].toInt()
+        if (version != VERSION) throw Exception("Unsupported archive version $version")
+
+        val indexOffset = readInt(footer, 0)
+        val index = byteArrayToString(readBlock(archive, indexOffset))
+                .split('\n')
+                .filter { it.isNotBlank() }
+                .map { line ->
+                    val array = json.parseToJsonElement(line).jsonArray
+                    IndexEntry(array[0].jsonPrimitive.int, array[1].jsonPrimitive.int,
+                            array[2].jsonPrimitive.int, array[3].jsonPrimitive.content)
+                }
+        for ((blockOffset, entries) in index.groupBy { it.blockOffset }) {
+            val block = readBlock(archive, blockOffset)
+            for (entry in entries) {
+                val names = entry.path.split('/')
+                if (names.any { it.isEmpty() || it == "." || it == ".." }) {
+                    throw Exception("Invalid path ${entry.path} in archive")
+                }
+                if (entry.offset < 0 || entry.length < 0 || entry.length > block.size - entry.offset) {
+                    throw Exception("Invalid range of ${entry.path} in archive $archive")
+                }
+                val file = names.fold(dir) { parent, name -> parent.child(name) }
+                file.write(block.copyOfRange(entry.offset, entry.offset + entry.length))
+            }
+        }
+    }
+
+    private fun forEachFile(file: NativeFile, path: List<String>, include: (List<String>) -> Boolean,
+                            action: (List<String>, ByteArray) -> Unit) {
+        if (!include(path)) return
+        when (val node = file.fileSystemNode) {
+            is RealFile -> {
+                val content = node.read()
+                if (content.isNotEmpty()) action(path, content)
+            }
+            is RealDirectory -> {
+                for (child in file.children().sortedBy { it.name }) {
+                    forEachFile(child, path + child.name, include, action)
+                }
+            }
+            is NonExistingNode -> Unit
+        }
+    }
+
+    private class Writer(private val archive: NativeFile) {
+        private var offset = 0L
+        private val block = ByteBuilder(BLOCK_SIZE)
+        private val index = StringBuilder()
+
+        init {
+            write(MAGIC + VERSION.toByte())
+        }
+
+        fun add(path: String, content: ByteArray) {
+            if (block.size > 0 && block.size + content.size > BLOCK_SIZE) {
+                flush()
+            }
+            val line = JsonArray(listOf(JsonPrimitive(offset.toInt()), JsonPrimitive(block.size),
+                    JsonPrimitive(content.size), JsonPrimitive(path)))
+            index.append(line.toString()).append('\n')
+            block.add(content)
+        }
+
+        fun finish() {
+            flush()
+            val indexOffset = offset.toInt()
+            writeBlock(index.toString().encodeToByteArray())
+            write(intToBytes(indexOffset) + MAGIC)
+        }
+
+        private fun flush() {
+            if (block.size == 0) return
+            writeBlock(block.toByteArray())
+            block.clear()
+        }
+
+        // Incompressible blocks are stored as is, which is recognized by equal sizes
+        private fun writeBlock(raw: ByteArray) {
+            val compressed = BlockCompression.compress(raw)
+            val stored = if (compressed.size < raw.size) compressed else raw
+            write(intToBytes(raw.size) + intToBytes(stored.size) + stored)
+        }
+
+        // Fails instead of writing offsets which do not fit in 32 bits
+        private fun write(bytes: ByteArray) {
+            if (offset + bytes.size > Int.MAX_VALUE) {
+                throw Exception("Archive $archive would exceed ${Int.MAX_VALUE} bytes")
+            }
+            archive.write(bytes, true)
+            offset += bytes.size
+        }
+    }
+
+    private fun readBlock(archive: NativeFile, offset: Int): ByteArray {
+        val sizes = readRange(archive, offset, 8)
+        val rawSize = readInt(sizes, 0)
+        val storedSize = readInt(sizes, 4)
+        if (rawSize < 0) throw Exception("Invalid archive $archive")
+        val stored = readRange(archive, offset + 8, storedSize)
+        return if (storedSize == rawSize) stored else BlockCompression.decompress(stored, rawSize)
+    }
+
+    private fun readRange(archive: NativeFile, offset: Int, length: Int): ByteArray {
+        if (offset < 0 || length < 0) throw Exception("Invalid archive $archive")
+        val bytes = archive.read(offset, length)
+        if (bytes == null || bytes.size != length) throw Exception("Invalid archive $archive")
+        return bytes
+    }
+
+    private fun intToBytes(value: Int): ByteArray =
+            byteArrayOf((value ushr 24).toByte(), (value ushr 16).toByte(), (value ushr 8).toByte(), value.toByte())
+
+    private fun readInt(bytes: ByteArray, offset: Int): Int =
+            ((bytes[offset].toInt() and 0xff) shl 24) or
+                    ((bytes[offset + 1].toInt() and 0xff) shl 16) or
+                    ((bytes[offset + 2].toInt() and 0xff) shl 8) or
+                    (bytes[offset + 3].toInt() and 0xff)
+}
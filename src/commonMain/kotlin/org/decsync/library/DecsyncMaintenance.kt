@@ -0,0 +1,248 @@
+/**
+ * libdecsync - DecsyncMaintenance.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+/**
+ * Offline inspection and maintenance of a collection, as done by the decsync-tool binary. The
+ * scans are split per app and run on [threads] threads, so large trees are handled quickly.
+ *
+ * [compact] and [prune] also modify the files of other apps, so they should only be used while no
+ * app syncs the collection.
+ */
+@ExperimentalStdlibApi
+object DecsyncMaintenance {
+    /**
+     * Statistics of an entries file, where [kind] is "new-entries" or "stored-entries". The
+     * [deadEntries] are superseded by a more recent entry with the same key in the same file.
+     */
+    data class FileStats(
+            val kind: String,
+            val appId: String,
+            val path: List<String>,
+            val bytes: Int,
+            val entries: Int,
+            val deadEntries: Int
+    )
+
+    /**
+     * A problem found by [verify] in [file], at the 1-based line number [line] if it applies.
+     */
+    data class Problem(val file: String, val line: Int?, val message: String)
+
+    /**
+     * The number of bytes written by [peerAppId] which are not yet read by [appId].
+     */
+    data class Lag(val appId: String, val peerAppId: String, val unreadBytes: Long)
+
+    private val KINDS = listOf("new-entries", "stored-entries")
+
+    fun stats(decsyncDir: NativeFile, syncType: String, collection: String?, threads: Int = 1): List<FileStats> {
+        val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+        val appDirs = KINDS.flatMap { kind -> appDirs(dir, kind).map { (appId, appDir) -> Triple(kind, appId, appDir) } }
+        return runPerApp(appDirs, threads) { (kind, appId, appDir), results: MutableList<FileStats> ->
+            appDir.listFilesRecursiveRelative { path ->
+                val file = appDir.child(path)
+                val entries = readEntries(file)
+                val latest = latestIndices(entries)
+                val count = entries.count { it != null }
+                results += FileStats(kind, appId, path.toList(), file.length(), count, count - latest.size)
+                true
+            }
+        }
+    }
+
+    /**
+     * Checks for unparsable lines, empty files and read offsets past the end of the corresponding
+     * new-entries file.
+     */
+    fun verify(decsyncDir: NativeFile, syncType: String, collection: String?, threads: Int = 1): List<Problem> {
+        val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+        val readBytesDirs = readBytesDirs(dir)
+        val storedProblems = runPerApp(appDirs(dir, "stored-entries"), threads) { (_, appDir), results: MutableList<Problem> ->
+            appDir.listFilesRecursiveRelative { path ->
+                verifyEntriesFile(appDir.child(path), results)
+                true
+            }
+        }
+        val newProblems = runPerApp(appDirs(dir, "new-entries"), threads) { (peerAppId, appDir), results: MutableList<Problem> ->
+            val sizes = HashMap<List<String>, Int>()
+            appDir.listFilesRecursiveRelative { path ->
+                val file = appDir.child(path)
+                sizes[path.toList()] = file.length()
+                verifyEntriesFile(file, results)
+                true
+            }
+            for (readBytesDir in readBytesDirs[peerAppId].orEmpty().values) {
+                readBytesDir.listFilesRecursiveRelative { path ->
+                    val file = readBytesDir.child(path)
+                    val readBytes = readOffset(file)
+                    val size = sizes[path.toList()] ?: 0
+                    when {
+                        readBytes == null -> results += Problem(file.toString(), null, "Invalid read offset")
+                        readBytes > size -> results += Problem(file.toString(), null, "Read offset $readBytes past end of file of size $size")
+                    }
+                    true
+                }
+            }
+        }
+        return storedProblems + newProblems
+    }
+
+    /**
+     * Returns the number of unread bytes for every pair of apps in the collection.
+     */
+    fun lag(decsyncDir: NativeFile, syncType: String, collection: String?, threads: Int = 1): List<Lag> {
+        val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+        val readBytesDirs = readBytesDirs(dir)
+        return runPerApp(appDirs(dir, "new-entries"), threads) { (peerAppId, appDir), results: MutableList<Lag> ->
+            val sizes = HashMap<List<String>, Int>()
+            appDir.listFilesRecursiveRelative { path ->
+                sizes[path.toList()] = appDir.child(path).length()
+                true
+            }
+            for ((appId, readBytesDir) in readBytesDirs[peerAppId].orEmpty()) {
+                var unreadBytes = 0L
+                for ((path, size) in sizes) {
+                    val readBytes = readOffset(readBytesDir.child(path)) ?: 0
+                    unreadBytes += maxOf(0, size - readBytes)
+                }
+                results += Lag(appId, peerAppId, unreadBytes)
+            }
+        }
+    }
+
+    /**
+     * Removes the dead entries from the new-entries files, of only [appId] if it is given. The
+     * read offsets of the other apps are moved to the new end of a file if they had read it
+     * completely, and are reset otherwise. Rereading entries is harmless, as they are only applied
+     * when they are more recent. Returns the number of removed lines.
+     */
+    fun compact(decsyncDir: NativeFile, syncType: String, collection: String?, appId: String? = null, threads: Int = 1): Int {
+        val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+        val readBytesDirs = readBytesDirs(dir)
+        val appDirs = appDirs(dir, "new-entries").filter { appId == null || it.first == appId }
+        return runPerApp(appDirs, threads) { (peerAppId, appDir), results: MutableList<Int> ->
+            appDir.listFilesRecursiveRelative { path ->
+                val file = appDir.child(path)
+                val lines = if (file.length() == 0) emptyList() else file.readLines()
+                val entries = lines.map { Decsync.Entry.fromLine(it) }
+                val latest = latestIndices(entries)
+                // Unparsable lines are kept, they are reported by verify
+                val liveLines = lines.filterIndexed { i, _ -> entries[i] == null || i in latest }
+                if (liveLines.size == lines.size) return@listFilesRecursiveRelative true
+
+                val oldSize = file.length()
+                file.writeLines(liveLines)
+                val newSize = file.length()
+                for (readBytesDir in readBytesDirs[peerAppId].orEmpty().values) {
+                    val readBytesFile = readBytesDir.child(path)
+                    val readBytes = readOffset(readBytesFile) ?: continue
+                    readBytesFile.writeText(if (readBytes >= oldSize) newSize.toString() else "0")
+                }
+                results += lines.size - liveLines.size
+                true
+            }
+        }.sum()
+    }
+
+    /**
+     * Deletes the data of the apps which were last active before [before], a date of the form
+     * `yyyy-MM-dd`. Apps without a known activity are kept. Returns the appIds of the deleted apps.
+     */
+    fun prune(decsyncDir: NativeFile, syncType: String, collection: String?, before: String): List<String> {
+        val (version, appDatas) = Decsync.getActiveApps(decsyncDir, syncType, collection)
+        val pruned = appDatas.filter { it.lastActive != null && it.lastActive < before }
+        for (appData in pruned) {
+            Log.d("Prune ${appData.appId}, last active ${appData.lastActive}")
+            Decsync.deleteAppData(decsyncDir, syncType, collection, appData.appId, appData.version, version)
+        }
+        return pruned.map { it.appId }
+    }
+
+    // The directories per app are resolved up front, as the caches of the shared parent
+    // directories are not thread-safe. Every task then only touches the subtree of its own app.
+    private fun appDirs(dir: DecsyncFile, kind: String): List<Pair<String, DecsyncFile>> {
+        val kindDir = dir.child(kind)
+        return kindDir.listDirectories().sorted().map { it to kindDir.child(it) }
+    }
+
+    // Read offsets per writing app and then per reading app
+    private fun readBytesDirs(dir: DecsyncFile): Map<String, Map<String, DecsyncFile>> {
+        val result = HashMap<String, HashMap<String, DecsyncFile>>()
+        for ((appId, appDir) in appDirs(dir, "read-bytes")) {
+            for (peerAppId in appDir.listDirectories().sorted()) {
+                result.getOrPut(peerAppId) { HashMap() }[appId] = appDir.child(peerAppId)
+            }
+        }
+        return result
+    }
+
+    private fun <A, T> runPerApp(apps: List<A>, threads: Int, scan: (A, MutableList<T>) -> Unit): List<T> {
+        val results = List(apps.size) { mutableListOf<T>() }
+        val tasks = apps.mapIndexed { i, app -> { scan(app, results[i]) } }
+        if (threads <= 1 || tasks.size <= 1) {
+            tasks.forEach { it() }
+        } else {
+            val pool = WorkerPool(minOf(threads, tasks.size))
+            try {
+                pool.runAll(tasks)
+            } finally {
+                pool.close()
+            }
+        }
+        return results.flatten()
+    }
+
+    private fun readEntries(file: DecsyncFile): List<Decsync.Entry?> =
+            if (file.length() == 0) emptyList() else file.readLines().map { Decsync.Entry.fromLine(it) }
+
+    private fun readOffset(file: DecsyncFile): Int? =
+            try {
+                if (file.length() == 0) null else file.readText()?.toIntOrNull()
+            } catch (e: Exception) {
+                null
+            }
+
+    private fun verifyEntriesFile(file: DecsyncFile, results: MutableList<Problem>) {
+        if (file.length() == 0) {
+            results += Problem(file.toString(), null, "Empty file")
+            return
+        }
+        // Blank lines are skipped by readLines, so the line numbers are counted here
+        val lines = file.file.read()?.let { byteArrayToString(it) }?.split('\n') ?: return
+        lines.forEachIndexed { i, line ->
+            if (line.isNotBlank() && Decsync.Entry.fromLine(line) == null) {
+                results += Problem(file.toString(), i + 1, "Unparsable line")
+            }
+        }
+    }
+
+    // Indices of the most recent entry per key, where a later line wins on equal datetimes
+    private fun latestIndices(entries: List<Decsync.Entry?>): Set<Int> {
+        val latest = HashMap<JsonText, Int>()
+        entries.forEachIndexed { i, entry ->
+            if (entry == null) return@forEachIndexed
+            val old = latest[entry.keyText]
+            if (old == null || entry.datetime >= entries[old]!!.datetime) {
+                latest[entry.keyText] = i
+            }
+        }
+        return latest.values.toHashSet()
+    }
+}
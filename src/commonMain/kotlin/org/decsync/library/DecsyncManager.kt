@@ -0,0 +1,110 @@
+/**
+ * libdecsync - DecsyncManager.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+/**
+ * Opens all collections of a [syncType] at once. This is meant for sync types with many
+ * collections, like "contacts" and "calendars".
+ *
+ * All [Decsync] instances share the directory cache of [decsyncDir] and the .decsync-info file is
+ * only read once. The new entries of all collections are executed in parallel on a pool of
+ * [poolSize] threads. The shared cache is not thread-safe, so the directories above the
+ * collections are resolved beforehand on the calling thread. The threads then only look up
+ * existing children of those shared directories and only modify the cache of their own collection.
+ *
+ * The instances must not be used while [executeAllNewEntries] is running.
+ *
+ * @param T the type of the extra data passed to the listeners.
+ * @param decsyncDir the directory in which the synchronized DecSync files are stored.
+ * @param syncType the type of data to sync. For example, "contacts" or "calendars".
+ * @param ownAppId the appId used for every collection. See [Decsync].
+ * @param poolSize the maximum number of collections which are executed at the same time.
+ * @param setup called for every opened collection, usually to add the listeners.
+ * @throws DecsyncException if a DecSync configuration error occurred.
+ */
+@ExperimentalStdlibApi
+class DecsyncManager<T>(
+        private val decsyncDir: NativeFile,
+        private val syncType: String,
+        private val ownAppId: String,
+        poolSize: Int = 4,
+        private val setup: (collection: String, decsync: Decsync<T>) -> Unit
+) {
+    private val pool = WorkerPool(poolSize)
+    private var mDecsyncs: Map<String, Decsync<T>> = open()
+
+    /**
+     * The opened [Decsync] instances by their collection.
+     */
+    val decsyncs: Map<String, Decsync<T>>
+        get() = mDecsyncs
+
+    operator fun get(collection: String): Decsync<T>? = mDecsyncs[collection]
+
+    private fun open(): Map<String, Decsync<T>> {
+        val decsyncInfo = getDecsyncInfoOrDefault(decsyncDir)
+        val syncTypeDir = getDecsyncSubdir(decsyncDir, syncType, null)
+        return listDecsyncCollections(decsyncDir, syncType).associateWith { collection ->
+            val collectionDir = syncTypeDir.child(collection)
+            val localDir = collectionDir.child("local", ownAppId)
+            Decsync<T>(decsyncDir, localDir, syncType, collection, ownAppId, decsyncInfo).also {
+                setup(collection, it)
+            }
+        }
+    }
+
+    /**
+     * Reopens all collections, such that collections created by other apps are included as well.
+     * The previous instances must not be used anymore.
+     */
+    fun refresh() {
+        getDecsyncSubdir(decsyncDir, syncType, null).resetCache()
+        mDecsyncs = open()
+    }
+
+    /**
+     * Calls [Decsync.executeAllNewEntries] for all collections in parallel.
+     *
+     * @param extra returns the extra userdata passed to the listeners of a collection.
+     */
+    fun executeAllNewEntries(extra: (collection: String) -> T) {
+        // Read the shared .decsync-info file beforehand, as its directory is not owned by a collection
+        val decsyncInfo = getDecsyncInfoOrDefault(decsyncDir)
+        resolveSharedDirs()
+        pool.runAll(mDecsyncs.map { (collection, decsync) ->
+            { decsync.executeAllNewEntries(extra(collection), false, decsyncInfo) }
+        })
+    }
+
+    // Loads the listings of the shared directories and of every collection directory, such that
+    // no task adds a child to a directory of which the cache is shared
+    private fun resolveSharedDirs() {
+        for (collection in mDecsyncs.keys) {
+            getDecsyncSubdir(decsyncDir, syncType, collection).file.children()
+        }
+    }
+
+    /**
+     * Stops the threads of the pool.
+     */
+    fun close() {
+        pool.close()
+    }
+}
@@ -2,6 +2,9 @@ package org.decsync.library
 
 import kotlinx.serialization.json.JsonPrimitive
 
+// Shared by all observers, as they have no life cycle to close a pool of their own
+private val diffPool by lazy { WorkerPool(4) }
+
 /**
  * Represents an observer that handles the DecSync updates when the internal data of the application
  * changes.
@@ -10,6 +13,9 @@ import kotlinx.serialization.json.JsonPrimitive
 abstract class DecsyncObserver(
         private var currentList: List<DecsyncItem>? = null
 ) {
+    // Keeps the updates in order
+    private val executor = SerialExecutor()
+
     /**
      * Function denoting whether DecSync is enabled. When this returns false, no DecSync updates
      * are executed, but the internal list is kept up-to-date.
@@ -29,7 +35,8 @@ abstract class DecsyncObserver(
     abstract fun executeStoredEntries(storedEntries: List<Decsync.StoredEntry>)
 
     /**
-     * Writes the current list as DecSync updates. Mostly used during an initial sync.
+     * Writes the current list as DecSync updates. Mostly used during an initial sync. All entries
+     * are given to a single call to [setEntries], so every DecSync file is written only once.
      */
     fun initSync() {
         applyDiff(insertions = currentList ?: return)
@@ -53,12 +60,17 @@ abstract class DecsyncObserver(
         if (oldList == null || !isDecsyncEnabled()) {
             return
         }
-        async {
-            val diffResult = Diff.calc(oldList, newListSorted, compareBy({ it.type }, { it.id }))
+        executor.execute {
+            val diffResult = Diff.calc(oldList, newListSorted, compareBy({ it.type }, { it.id }), diffPool)
             applyDiff(diffResult, isFromDecsyncListener)
         }
     }
 
+    /**
+     * Waits until the updates of all previous calls to [updateList] are written.
+     */
+    fun flush() = executor.flush()
+
     /**
      * Similar to [updateList], but directly uses a difference.
      */
@@ -77,32 +89,60 @@ abstract class DecsyncObserver(
             changes: List<Pair<DecsyncItem, DecsyncItem>> = emptyList(),
             isFromDecsyncListener: Boolean = false
     ) {
-        val entries = mutableListOf<Decsync.EntryWithPath>()
-        val storedEntries = mutableListOf<Decsync.StoredEntry>()
-        for (item in insertions) {
-            for ((storedEntry, value) in item.entries) {
-                val (path, key) = storedEntry
-                if (value.isDefault()) {
-                    storedEntries.add(storedEntry)
-                } else {
-                    entries.add(Decsync.EntryWithPath(path, key, value.toJson()))
-                }
-            }
-            val (path, key) = item.idStoredEntry ?: continue
-            entries.add(Decsync.EntryWithPath(path, key, JsonPrimitive(true)))
+        val updates = DecsyncUpdates()
+        insertions.forEach { updates.addInsertion(it) }
+        deletions.forEach { updates.addDeletion(it) }
+        for ((oldItem, newItem) in changes) {
+            updates.addChange(oldItem.entries, newItem)
         }
-        for (item in deletions) {
-            val (path, key) = item.idStoredEntry ?: continue
-            entries.add(Decsync.EntryWithPath(path, key, JsonPrimitive(false)))
+        updates.apply(this::setEntries, this::executeStoredEntries, isFromDecsyncListener)
+    }
+}
+
+/**
+ * Collects the DecSync updates corresponding to changes of [DecsyncItem]s.
+ */
+@ExperimentalStdlibApi
+internal class DecsyncUpdates {
+    private val entries = mutableListOf<Decsync.EntryWithPath>()
+    private val storedEntries = mutableListOf<Decsync.StoredEntry>()
+
+    fun addInsertion(item: DecsyncItem) {
+        for ((storedEntry, value) in item.entries) {
+            val (path, key) = storedEntry
+            if (value.isDefault()) {
+                storedEntries.add(storedEntry)
+            } else {
+                entries.add(Decsync.EntryWithPath(path, key, value.toJson()))
+            }
         }
-        for ((oldItem, newItem) in changes) {
-            for ((storedEntry, value) in newItem.entries) {
-                val (path, key) = storedEntry
-                if (value != oldItem.entries[storedEntry]) {
-                    entries.add(Decsync.EntryWithPath(path, key, value.toJson()))
-                }
+        val (path, key) = item.idStoredEntry ?: return
+        entries.add(Decsync.EntryWithPath(path, key, JsonPrimitive(true)))
+    }
+
+    fun addDeletion(item: DecsyncItem) {
+        val (path, key) = item.idStoredEntry ?: return
+        entries.add(Decsync.EntryWithPath(path, key, JsonPrimitive(false)))
+    }
+
+    /**
+     * Adds the entries of [newItem] which differ from [oldEntries]. If the old entries are unknown,
+     * all entries are added. Unchanged values are filtered out by DecSync itself.
+     */
+    fun addChange(oldEntries: Map<Decsync.StoredEntry, DecsyncItem.Value>?, newItem: DecsyncItem) {
+        for ((storedEntry, value) in newItem.entries) {
+            val (path, key) = storedEntry
+            if (oldEntries == null || value != oldEntries[storedEntry]) {
+                entries.add(Decsync.EntryWithPath(path, key, value.toJson()))
             }
         }
+    }
+
+    fun apply(
+            setEntries: (List<Decsync.EntryWithPath>) -> Unit,
+            executeStoredEntries: (List<Decsync.StoredEntry>) -> Unit,
+            isFromDecsyncListener: Boolean
+    ) {
         if (!isFromDecsyncListener && entries.isNotEmpty()) {
             setEntries(entries)
         }
@@ -110,4 +150,4 @@ abstract class DecsyncObserver(
             executeStoredEntries(storedEntries)
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,77 @@
+/**
+ * libdecsync - DecsyncReader.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlinx.serialization.json.JsonElement
+
+/**
+ * Read-only access to the current state of a DecSync collection, for example for reporting or
+ * other secondary readers.
+ *
+ * Unlike [Decsync], a reader has no appId and never writes to the DecSync directory: no directories
+ * or info files are created and no entries are marked as read. The values are read directly from
+ * the stored entries of all apps, taking the most recent value for every key. Hence any number of
+ * readers can be used concurrently, also while other apps are writing to the directory. A single
+ * reader must only be used by one thread at a time.
+ *
+ * @param decsyncDir the directory in which the synchronized DecSync files are stored.
+ * @param syncType the type of data to sync. For example, "rss", "contacts" or "calendars".
+ * @param collection an optional collection identifier. See [Decsync].
+ * @throws DecsyncException if a DecSync configuration error occurred.
+ */
+@ExperimentalStdlibApi
+class DecsyncReader(
+        private val decsyncDir: NativeFile,
+        private val syncType: String,
+        private val collection: String?
+) {
+    private val version = getDecsyncVersionReadOnly(decsyncDir)
+
+    private fun readAllStoredEntries(
+            prefix: List<String>,
+            exact: Boolean,
+            keys: Collection<JsonText>? = null
+    ): Map<List<String>, Map<JsonText, Decsync.Entry>> =
+            when (version) {
+                DecsyncVersion.V1 -> DecsyncV1.readAllStoredEntries(decsyncDir, syncType, collection, prefix, exact, keys)
+            }
+
+    /**
+     * Returns the most recent entry in [path] with key [key], or null if it does not exist.
+     */
+    fun getStoredEntry(path: List<String>, key: JsonElement): Decsync.Entry? {
+        val keyText = JsonText(key)
+        return readAllStoredEntries(path, true, listOf(keyText))[path]?.get(keyText)
+    }
+
+    /**
+     * Returns the most recent entries in exactly the path [path].
+     */
+    fun getStoredEntriesForPathExact(path: List<String>): List<Decsync.Entry> =
+            readAllStoredEntries(path, true)[path]?.values?.toList() ?: emptyList()
+
+    /**
+     * Returns the most recent entries in all paths starting with [prefix].
+     */
+    fun getStoredEntriesForPathPrefix(prefix: List<String>): List<Decsync.EntryWithPath> =
+            readAllStoredEntries(prefix, false).flatMap { (path, entries) ->
+                entries.values.map { Decsync.EntryWithPath(path, it) }
+            }
+}
@@ -29,6 +29,7 @@ internal class DecsyncV1<T>(
         override val ownAppId: String
 ) : DecsyncInst<T>() {
     private val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+    private val flagPrefixes = FlagCodec.flagPrefixes(syncType)
 
     init {
         // Create shared directories
@@ -38,8 +39,14 @@ internal class DecsyncV1<T>(
         dir.child("stored-entries").mkdir()
     }
 
-    private fun entriesToLines(entries: Collection<Decsync.Entry>): List<String> =
-            entries.map { it.toJson().toString() }
+    private fun isFlagPath(path: List<String>): Boolean =
+            flagPrefixes.any { prefix -> path.size >= prefix.size && path.subList(0, prefix.size) == prefix }
+
+    private fun entriesToLines(path: List<String>, entries: Collection<Decsync.Entry>): List<String> =
+            if (isFlagPath(path)) entries.map { FlagCodec.toLine(it) } else entries.map { it.toLine() }
+
+    private fun lineParser(path: List<String>): (String) -> Decsync.Entry? =
+            if (isFlagPath(path)) FlagCodec()::fromLine else { line -> Decsync.Entry.fromLine(line) }
 
     private class EntriesLocation(val path: List<String>, val newEntriesFile: DecsyncFile, val storedEntriesFile: DecsyncFile, val readBytesFile: DecsyncFile)
 
@@ -51,103 +58,187 @@ internal class DecsyncV1<T>(
                     dir.child(listOf("read-bytes", ownAppId, appId) + path)
             )
 
-    override fun setEntriesForPath(path: List<String>, entries: List<Decsync.Entry>) {
-        val entriesLocation = getNewEntriesLocation(path, ownAppId)
-
-        // Update stored entries
-        val entries = entries.toMutableList()
-        updateStoredEntries(entriesLocation, entries, NoExtra(), true)
-        if (entries.isEmpty()) return
+    override fun setEntriesForPath(path: List<String>, entries: List<Decsync.Entry>) =
+            writeEntries(mapOf(path to entries))
+
+    override fun setEntries(entriesWithPath: List<Decsync.EntryWithPath>) =
+            writeEntries(entriesWithPath.groupBy({ it.path }, { it.entry }))
+
+    /**
+     * Writes the entries of all paths, sorted by path. Every file is written at most once and
+     * every sequence file is updated at most once, which matters for bulk writes like an initial
+     * sync.
+     */
+    private fun writeEntries(entriesByPath: Map<List<String>, List<Decsync.Entry>>) {
+        val writtenEntries = mutableListOf<Decsync.Entry>()
+        val sequencePaths = LinkedHashSet<List<String>>()
+        for (path in entriesByPath.keys.sortedWith(pathComparator)) {
+            val entriesLocation = getNewEntriesLocation(path, ownAppId)
+
+            // Update stored entries
+            // Without stored entries for the path, e.g. during an initial sync, there is nothing
+            // to compare the new entries with
+            val entries = entriesByPath.getValue(path).toMutableList()
+            val hasStoredEntries = entriesLocation.storedEntriesFile.file.fileSystemNode is RealFile
+            if (hasStoredEntries) {
+                val storedEntries = filterStoredEntries(entriesLocation, entries, true)
+                writeStoredEntries(entriesLocation, storedEntries, entries)
+                if (entries.isEmpty()) continue
+            }
+            val lines = entriesToLines(path, entries)
+            if (!hasStoredEntries) {
+                entriesLocation.storedEntriesFile.writeLines(lines, true)
+                changeJournal.append(path, entries)
+            }
 
-        // Write new entries
-        val lines = entriesToLines(entries)
-        entriesLocation.newEntriesFile.writeLines(lines, true)
+            // Write new entries
+            entriesLocation.newEntriesFile.writeLines(lines, true)
+            writtenEntries += entries
+            for (i in path.indices) {
+                sequencePaths.add(path.subList(0, i))
+            }
+        }
 
         // Update sequence files
-        var sequenceDir = dir.child("new-entries", ownAppId)
-        for (name in path) {
-            val file = sequenceDir.hiddenChild("decsync-sequence")
+        for (path in sequencePaths) {
+            val file = dir.child(listOf("new-entries", ownAppId) + path).hiddenChild("decsync-sequence")
             val version = file.readText()?.toLongOrNull() ?: 0
             file.writeText((version + 1).toString())
-            sequenceDir = sequenceDir.child(name)
         }
+
+        updateLatestStoredEntry(writtenEntries)
     }
 
-    override fun executeAllNewEntries(optExtra: OptExtra<T>) {
+    override fun newEntryBatches(): Sequence<NewEntriesBatch> = sequence {
         val newEntriesDir = dir.child("new-entries")
         newEntriesDir.resetCache()
         val readBytesDir = dir.child("read-bytes", ownAppId)
         val appIds = newEntriesDir.listDirectories().filter { it != ownAppId }
         for (appId in appIds) {
-            newEntriesDir.child(appId)
-                    .listFilesRecursiveRelative(readBytesDir.child(appId)) { path ->
-                        val entriesLocation = getNewEntriesLocation(path, appId)
-                        executeEntriesLocation(entriesLocation, optExtra)
+            yieldNewEntries(newEntriesDir.child(appId), readBytesDir.child(appId), appId, emptyList())
+        }
+    }
+
+    // Lazy version of [DecsyncFile.listFilesRecursiveRelative], which also skips the directories
+    // whose sequence number is already read
+    private suspend fun SequenceScope<NewEntriesBatch>.yieldNewEntries(
+            file: DecsyncFile,
+            readBytesSrc: DecsyncFile,
+            appId: String,
+            path: List<String>
+    ): Boolean {
+        return when (val node = file.file.fileSystemNode) {
+            is RealFile -> yieldEntriesLocation(getNewEntriesLocation(path, appId))
+            is RealDirectory -> {
+                val seq = file.hiddenChild("decsync-sequence").readText()
+                if (seq != null && seq == readBytesSrc.hiddenChild("decsync-sequence").readText()) {
+                    return true
+                }
+                val names = node.children(file.file)
+                        .map { it.name }
+                        .filter { it[0] != '.' }
+                        .mapNotNull { Url.decode(it) }
+                var success = true
+                for (name in names) {
+                    if (!yieldNewEntries(file.child(name), readBytesSrc.child(name), appId, path + name)) {
+                        success = false
+                        break
                     }
+                }
+                if (seq != null && success) {
+                    readBytesSrc.hiddenChild("decsync-sequence").writeText(seq)
+                }
+                success
+            }
+            is NonExistingNode -> true
         }
     }
 
-    private fun executeEntriesLocation(entriesLocation: EntriesLocation,
-                                       optExtra: OptExtra<T>,
-                                       keys: List<JsonElement>? = null): Boolean {
+    // The stored entries and read bytes are only updated once the consumer of the batch continues
+    private suspend fun SequenceScope<NewEntriesBatch>.yieldEntriesLocation(entriesLocation: EntriesLocation): Boolean {
         val readBytes = entriesLocation.readBytesFile.readText()?.toIntOrNull() ?: 0
         val size = entriesLocation.newEntriesFile.length()
         if (readBytes >= size) return true
 
-        val entries = readEntriesFromFile(entriesLocation.newEntriesFile, readBytes, keys)
-        val allSuccess = updateStoredEntries(entriesLocation, entries, optExtra)
+        val entries = readEntriesFromFile(entriesLocation.newEntriesFile, entriesLocation.path, readBytes)
+        val storedEntries = filterStoredEntries(entriesLocation, entries)
+        val batch = NewEntriesBatch(entriesLocation.path, entries)
+        yield(batch)
+        val currentStoredEntries = if (batch.recheck) filterStoredEntries(entriesLocation, batch.entries) else storedEntries
+        writeStoredEntries(entriesLocation, currentStoredEntries, batch.entries)
+        updateLatestStoredEntry(batch.entries)
 
-        if (allSuccess) {
+        if (batch.success) {
             entriesLocation.readBytesFile.writeText(size.toString())
         }
-        return allSuccess
+        return batch.success
     }
 
-    private fun readEntriesFromFile(file: DecsyncFile, readBytes: Int, keys: List<JsonElement>? = null): MutableList<Decsync.Entry> {
-        return file.readLines(readBytes)
-                .mapNotNull { Decsync.Entry.fromLine(it) }
-                .filter { keys == null || it.key in keys }
-                .groupBy { it.key }.values
-                .map { it.maxByOrNull { it.datetime }!! }
-                .toMutableList()
+    private fun readEntriesFromFile(file: DecsyncFile, path: List<String>, readBytes: Int, keys: Collection<JsonText>? = null): MutableList<Decsync.Entry> {
+        val parseLine = lineParser(path)
+        // A file without any of the keys is skipped. Keys with objects of multiple members are not
+        // compared by their text, so they always require the file to be read.
+        val keyIndex = if (readBytes == 0) file.file.keyIndex() else null
+        val indexedKeys = keyIndex?.keys
+        if (keys != null && indexedKeys != null && keys.all { it.isOrdered && it.text !in indexedKeys }) {
+            return mutableListOf()
+        }
+        val allKeys = if (keyIndex != null && indexedKeys == null) HashSet<String>() else null
+        // Keep the latest entry of every key, in a single pass
+        val latestEntries = LinkedHashMap<JsonText, Decsync.Entry>()
+        for (line in file.readLines(readBytes)) {
+            val entry = parseLine(line) ?: continue
+            allKeys?.add(entry.keyText.text)
+            if (keys != null && entry.keyText !in keys) continue
+            val latestEntry = latestEntries[entry.keyText]
+            if (latestEntry == null || entry.datetime > latestEntry.datetime) {
+                latestEntries[entry.keyText] = entry
+            }
+        }
+        if (allKeys != null) keyIndex?.update?.invoke(allKeys)
+        return latestEntries.values.toMutableList()
     }
 
-    private fun updateStoredEntries(
+    /**
+     * Removes the [entries] which are not newer than the stored ones, or which have the same value
+     * when [requireNewValue] is set. Returns the stored entries by key.
+     */
+    private fun filterStoredEntries(
             entriesLocation: EntriesLocation,
             entries: MutableList<Decsync.Entry>,
-            optExtra: OptExtra<T>,
             requireNewValue: Boolean = false
-    ): Boolean {
-        // Get a map of the stored entries
-        val storedEntries = HashMap<JsonElement, Decsync.Entry>()
+    ): HashMap<JsonText, Decsync.Entry> {
+        val storedEntries = HashMap<JsonText, Decsync.Entry>()
         entriesLocation.storedEntriesFile.readLines()
-                .mapNotNull { Decsync.Entry.fromLine(it) }
+                .mapNotNull(lineParser(entriesLocation.path))
                 .forEach {
-                    storedEntries[it.key] = it
+                    storedEntries[it.keyText] = it
                 }
 
-        // Filter out entries which are not newer than the stored one
         val iterator = entries.iterator()
         while (iterator.hasNext()) {
             val entry = iterator.next()
-            val storedEntry = storedEntries[entry.key] ?: continue
-            if (entry.datetime <= storedEntry.datetime || (requireNewValue && entry.value == storedEntry.value)) {
+            val storedEntry = storedEntries[entry.keyText] ?: continue
+            if (entry.datetime <= storedEntry.datetime || (requireNewValue && entry.valueText == storedEntry.valueText)) {
                 iterator.remove()
             }
         }
+        return storedEntries
+    }
 
-        // Execute the new entries
-        // This also filters out any entries for which the listener fails
-        val success = if (optExtra is WithExtra) {
-            callListener(entriesLocation.path, entries, optExtra.value)
-        } else {
-            true
-        }
-
+    /**
+     * Stores the [entries], replacing the entries with the same key in [storedEntries]. The entries
+     * are also added to the change journal.
+     */
+    private fun writeStoredEntries(
+            entriesLocation: EntriesLocation,
+            storedEntries: HashMap<JsonText, Decsync.Entry>,
+            entries: List<Decsync.Entry>
+    ) {
         // Filter out the stored entries for which a new value is inserted
         var storedEntriesRemoved = false
         for (entry in entries) {
-            val storedEntry = storedEntries.remove(entry.key)
+            val storedEntry = storedEntries.remove(entry.keyText)
             if (storedEntry != null) {
                 storedEntriesRemoved = true
             }
@@ -155,15 +246,12 @@ internal class DecsyncV1<T>(
 
         // Write the new stored entries
         if (storedEntriesRemoved) {
-            val lines = entriesToLines(storedEntries.values)
+            val lines = entriesToLines(entriesLocation.path, storedEntries.values)
             entriesLocation.storedEntriesFile.writeLines(lines)
         }
-        val lines = entriesToLines(entries)
+        val lines = entriesToLines(entriesLocation.path, entries)
         entriesLocation.storedEntriesFile.writeLines(lines, true)
-
-        updateLatestStoredEntry(entries)
-
-        return success
+        changeJournal.append(entriesLocation.path, entries)
     }
 
     private fun updateLatestStoredEntry(entries: List<Decsync.Entry>) {
@@ -175,23 +263,69 @@ internal class DecsyncV1<T>(
         }
     }
 
-    override fun executeStoredEntriesForPathExact(path: List<String>, extra: T, keys: List<JsonElement>?): Boolean =
+    override fun executeStoredEntries(storedEntries: List<Decsync.StoredEntry>, extra: T): Boolean {
+        var allSuccess = true
+        val keysByPath = storedEntries.groupBy({ it.path }, { JsonText(it.key) })
+        for (path in keysByPath.keys.sortedWith(pathComparator)) {
+            val keys = keysByPath.getValue(path)
+            val file = dir.child(listOf("stored-entries", ownAppId) + path)
+            // Read the file of the path directly, instead of walking it as a prefix
+            val success = when (file.file.fileSystemNode) {
+                is RealFile -> callListener(path, readEntriesFromFile(file, path, 0, keys.toHashSet()), extra)
+                is RealDirectory -> executeStoredEntriesForPathPrefix(path, extra, keys)
+                is NonExistingNode -> true
+            }
+            allSuccess = allSuccess && success
+        }
+        return allSuccess
+    }
+
+    override fun executeStoredEntriesForPathExact(path: List<String>, extra: T, keys: List<JsonText>?): Boolean =
             executeStoredEntriesForPathPrefix(path, extra, keys)
 
     override fun executeStoredEntriesForPathPrefix(
             prefix: List<String>,
             extra: T,
-            keys: List<JsonElement>?
+            keys: List<JsonText>?
     ): Boolean {
+        val keySet = keys?.toHashSet()
         return dir.child(listOf("stored-entries", ownAppId) + prefix)
                 .listFilesRecursiveRelative {
                     val path = prefix + it
                     val file = dir.child(listOf("stored-entries", ownAppId) + path)
-                    val entries = readEntriesFromFile(file, 0, keys)
+                    val entries = readEntriesFromFile(file, path, 0, keySet)
                     callListener(path, entries, extra)
                 }
     }
 
+    override fun storedEntries(prefix: List<String>): Sequence<Decsync.EntryWithPath> = sequence {
+        yieldStoredEntries(prefix)
+    }
+
+    // Depth-first walk over the sorted children, which gives the order of [pathComparator]
+    private suspend fun SequenceScope<Decsync.EntryWithPath>.yieldStoredEntries(path: List<String>) {
+        val file = dir.child(listOf("stored-entries", ownAppId) + path)
+        when (val node = file.file.fileSystemNode) {
+            is RealFile -> {
+                for (entry in readEntriesFromFile(file, path, 0)) {
+                    if (isInternalEntry(path, entry)) continue
+                    yield(Decsync.EntryWithPath(path, entry))
+                }
+            }
+            is RealDirectory -> {
+                val names = node.children(file.file)
+                        .map { it.name }
+                        .filter { it[0] != '.' }
+                        .mapNotNull { Url.decode(it) }
+                        .sorted()
+                for (name in names) {
+                    yieldStoredEntries(path + name)
+                }
+            }
+            is NonExistingNode -> Unit
+        }
+    }
+
     override fun latestAppId(): String {
         var latestAppId: String? = null
         var latestDatetime: String? = null
@@ -218,6 +352,15 @@ internal class DecsyncV1<T>(
     }
 
     companion object {
+        // Lexicographic order, such that the files of a directory are written consecutively
+        private val pathComparator = Comparator<List<String>> { a, b ->
+            for (i in 0 until minOf(a.size, b.size)) {
+                val cmp = a[i].compareTo(b[i])
+                if (cmp != 0) return@Comparator cmp
+            }
+            a.size - b.size
+        }
+
         fun getStaticInfo(
                 decsyncDir: NativeFile,
                 syncType: String,
@@ -253,6 +396,47 @@ internal class DecsyncV1<T>(
             return info
         }
 
+        /**
+         * Reads the stored entries of all apps in the path [prefix] and its subpaths, or only in
+         * [prefix] itself when [exact] is set. The entries are merged per path and key by taking
+         * the most recent one. On equal datetimes, the first appId in sorted order wins. The info
+         * entries maintained by the library itself are skipped.
+         */
+        fun readAllStoredEntries(
+                decsyncDir: NativeFile,
+                syncType: String,
+                collection: String?,
+                prefix: List<String>,
+                exact: Boolean,
+                keys: Collection<JsonText>?
+        ): Map<List<String>, Map<JsonText, Decsync.Entry>> {
+            val dir = getDecsyncSubdir(decsyncDir, syncType, collection)
+            val storedEntriesDir = dir.child("stored-entries")
+            // Also see the changes by other apps since the previous call
+            storedEntriesDir.resetCache()
+            val result = HashMap<List<String>, HashMap<JsonText, Decsync.Entry>>()
+            for (appId in storedEntriesDir.listDirectories().sorted()) {
+                val appDir = storedEntriesDir.child(appId)
+                appDir.child(prefix).listFilesRecursiveRelative(null, { !exact }) {
+                    val path = prefix + it
+                    val entries = result.getOrPut(path) { HashMap() }
+                    appDir.child(path).readLines()
+                            .mapNotNull { line -> Decsync.Entry.fromLine(line) }
+                            .filter { entry ->
+                                (keys == null || entry.keyText in keys) && !DecsyncInst.isInternalEntry(path, entry)
+                            }
+                            .forEach { entry ->
+                                val oldEntry = entries[entry.keyText]
+                                if (oldEntry == null || entry.datetime > oldEntry.datetime) {
+                                    entries[entry.keyText] = entry
+                                }
+                            }
+                    true
+                }
+            }
+            return result
+        }
+
         fun getActiveApps(
                 decsyncDir: NativeFile,
                 syncType: String,
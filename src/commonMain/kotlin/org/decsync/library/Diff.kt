@@ -1,6 +1,12 @@
 package org.decsync.library
 
 object Diff {
+    /**
+     * Minimal number of items in a chunk of [calc] with a parallelism larger than 1. Smaller lists
+     * are not split, as the overhead of the threads would dominate.
+     */
+    private const val MIN_CHUNK_SIZE = 25_000
+
     data class Result<out T>(
             val insertions: List<T>,
             val deletions: List<T>,
@@ -17,39 +23,129 @@ object Diff {
      * with respect to this ordering.
      */
     fun <T> calc(oldList: List<T>, newList: List<T>, comparator: Comparator<T>): Result<T> {
-        var i = 0
-        var j = 0
-        val insertions = mutableListOf<T>()
-        val deletions = mutableListOf<T>()
-        val changes = mutableListOf<Pair<T, T>>()
-        while (true) {
-            if (i == oldList.size) {
-                insertions += newList.drop(j)
-                break
+        val result = Builder<T>()
+        result.calc(oldList, 0, oldList.size, newList, 0, newList.size, comparator)
+        return result.build()
+    }
+
+    /**
+     * Similar to [calc], but large lists are split into chunks at matching identifiers, which are
+     * compared on [parallelism] threads. The result is equal to the one of [calc].
+     */
+    fun <T> calc(oldList: List<T>, newList: List<T>, comparator: Comparator<T>, parallelism: Int): Result<T> {
+        if (parallelism <= 1) {
+            return calc(oldList, newList, comparator)
+        }
+        val pool = WorkerPool(parallelism)
+        try {
+            return calc(oldList, newList, comparator, pool)
+        } finally {
+            pool.close()
+        }
+    }
+
+    /**
+     * Similar to [calc], but the chunks are compared on the threads of [pool], such that repeated
+     * calls do not start new threads.
+     */
+    internal fun <T> calc(oldList: List<T>, newList: List<T>, comparator: Comparator<T>, pool: WorkerPool): Result<T> {
+        val longList = if (oldList.size >= newList.size) oldList else newList
+        val chunkCount = minOf(4 * pool.size, longList.size / MIN_CHUNK_SIZE)
+        if (pool.size <= 1 || chunkCount <= 1) {
+            return calc(oldList, newList, comparator)
+        }
+
+        // Split both lists before the same values of the longest list. Equal identifiers always
+        // end up in the same chunk, as the lower bound is used.
+        val oldBounds = IntArray(chunkCount + 1)
+        val newBounds = IntArray(chunkCount + 1)
+        for (k in 1 until chunkCount) {
+            val pivot = longList[k * longList.size / chunkCount]
+            oldBounds[k] = lowerBound(oldList, pivot, comparator)
+            newBounds[k] = lowerBound(newList, pivot, comparator)
+        }
+        oldBounds[chunkCount] = oldList.size
+        newBounds[chunkCount] = newList.size
+
+        val results = List(chunkCount) { Builder<T>() }
+        val tasks = List(chunkCount) { k ->
+            {
+                results[k].calc(
+                        oldList, oldBounds[k], oldBounds[k + 1],
+                        newList, newBounds[k], newBounds[k + 1],
+                        comparator
+                )
             }
-            if (j == newList.size) {
-                deletions += oldList.drop(i)
-                break
+        }
+        pool.runAll(tasks)
+
+        val result = Builder<T>()
+        for (chunkResult in results) {
+            result.insertions += chunkResult.insertions
+            result.deletions += chunkResult.deletions
+            result.changes += chunkResult.changes
+        }
+        return result.build()
+    }
+
+    private fun <T> lowerBound(list: List<T>, value: T, comparator: Comparator<T>): Int {
+        var low = 0
+        var high = list.size
+        while (low < high) {
+            val mid = (low + high) ushr 1
+            if (comparator.compare(list[mid], value) < 0) {
+                low = mid + 1
+            } else {
+                high = mid
             }
-            val cmp = comparator.compare(oldList[i], newList[j])
-            when {
-                cmp > 0 -> {
-                    insertions += newList[j]
-                    j++
+        }
+        return low
+    }
+
+    private class Builder<T> {
+        val insertions = ArrayList<T>()
+        val deletions = ArrayList<T>()
+        val changes = ArrayList<Pair<T, T>>()
+
+        fun calc(
+                oldList: List<T>, oldFrom: Int, oldTo: Int,
+                newList: List<T>, newFrom: Int, newTo: Int,
+                comparator: Comparator<T>
+        ) {
+            var i = oldFrom
+            var j = newFrom
+            while (true) {
+                if (i == oldTo) {
+                    insertions.addAll(newList.subList(j, newTo))
+                    break
                 }
-                cmp < 0 -> {
-                    deletions += oldList[i]
-                    i++
+                if (j == newTo) {
+                    deletions.addAll(oldList.subList(i, oldTo))
+                    break
                 }
-                else -> {
-                    if (oldList[i] != newList[j]) {
-                        changes += oldList[i] to newList[j]
+                val oldValue = oldList[i]
+                val newValue = newList[j]
+                val cmp = comparator.compare(oldValue, newValue)
+                when {
+                    cmp > 0 -> {
+                        insertions += newValue
+                        j++
+                    }
+                    cmp < 0 -> {
+                        deletions += oldValue
+                        i++
+                    }
+                    else -> {
+                        if (oldValue != newValue) {
+                            changes += oldValue to newValue
+                        }
+                        i++
+                        j++
                     }
-                    i++
-                    j++
                 }
             }
         }
-        return Result(insertions, deletions, changes)
+
+        fun build(): Result<T> = Result(insertions, deletions, changes)
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,78 @@
+/**
+ * libdecsync - FlagCodec.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlinx.serialization.json.JsonPrimitive
+
+/**
+ * Parser and writer for the lines of flag paths, whose values are booleans. Such paths often
+ * contain a large number of small entries, like the read and marked flags of RSS articles. The
+ * lines use the normal format, but are handled without the generic JSON scanner:
+ * - the boolean value is recognized at the end of the line and shared between all entries,
+ * - equal consecutive datetimes, as written by a bulk write, share the same string.
+ * Lines with a different shape are given to [Decsync.Entry.fromLine].
+ *
+ * A parser keeps state between lines, so a new one is used for every file.
+ */
+@ExperimentalStdlibApi
+internal class FlagCodec {
+    private var lastDatetime = ""
+
+    fun fromLine(line: String): Decsync.Entry? {
+        val value = when {
+            line.endsWith(",true]") -> TRUE
+            line.endsWith(",false]") -> FALSE
+            else -> return Decsync.Entry.fromLine(line)
+        }
+        val keyEnd = line.length - value.text.length - 2
+        val datetimeEnd = line.indexOf('"', 2)
+        if (!line.startsWith("[\"") || datetimeEnd < 0 || datetimeEnd + 2 > keyEnd ||
+                line[datetimeEnd + 1] != ',' || line.lastIndexOf('\\', datetimeEnd) >= 0) {
+            return Decsync.Entry.fromLine(line)
+        }
+        val key = try {
+            JsonText.fromText(line.substring(datetimeEnd + 2, keyEnd))
+        } catch (e: Exception) {
+            return Decsync.Entry.fromLine(line)
+        }
+        if (!line.regionMatches(2, lastDatetime, 0, datetimeEnd - 2) || lastDatetime.length != datetimeEnd - 2) {
+            lastDatetime = line.substring(2, datetimeEnd)
+        }
+        return Decsync.Entry(lastDatetime, key, value)
+    }
+
+    companion object {
+        private val TRUE = JsonText(JsonPrimitive(true))
+        private val FALSE = JsonText(JsonPrimitive(false))
+
+        fun toLine(entry: Decsync.Entry): String {
+            val datetime = entry.datetime
+            if (datetime.any { it == '"' || it == '\\' || it < ' ' }) return entry.toLine()
+            return "[\"$datetime\",${entry.keyText.text},${entry.valueText.text}]"
+        }
+
+        /**
+         * Returns the prefixes of the flag paths of [syncType].
+         */
+        fun flagPrefixes(syncType: String): List<List<String>> = when (syncType) {
+            "rss" -> listOf(listOf("articles", "read"), listOf("articles", "marked"))
+            else -> emptyList()
+        }
+    }
+}
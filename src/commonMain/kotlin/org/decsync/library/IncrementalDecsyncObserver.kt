@@ -0,0 +1,166 @@
+/**
+ * libdecsync - IncrementalDecsyncObserver.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+/**
+ * Variant of [DecsyncObserver] for large lists of items. Instead of the full list, it only keeps a
+ * 64-bit hash of the entries of every item, and the changes are given explicitly by [upsert] and
+ * [delete]. Hence the work of an update is proportional to the number of changed items, not to the
+ * size of the list.
+ *
+ * As the old entries of a changed item are unknown, all its entries are written again. DecSync
+ * filters out the ones with unchanged values.
+ *
+ * All updates are executed in the background, in order. Use [flush] to wait for them.
+ */
+@ExperimentalStdlibApi
+abstract class IncrementalDecsyncObserver {
+    private val hashes = HashMap<Pair<String, Comparable<*>>, Long>()
+    private val executor = SerialExecutor()
+
+    /**
+     * See [DecsyncObserver.isDecsyncEnabled].
+     */
+    abstract fun isDecsyncEnabled(): Boolean
+
+    /**
+     * See [DecsyncObserver.setEntries].
+     */
+    abstract fun setEntries(entries: List<Decsync.EntryWithPath>)
+
+    /**
+     * See [DecsyncObserver.executeStoredEntries].
+     */
+    abstract fun executeStoredEntries(storedEntries: List<Decsync.StoredEntry>)
+
+    /**
+     * Initializes the known items to [items], without writing any updates. This corresponds to the
+     * first call to [DecsyncObserver.updateList].
+     */
+    fun initItems(items: Iterable<DecsyncItem>) = executor.execute {
+        hashes.clear()
+        for (item in items) {
+            hashes[key(item)] = hash(item)
+        }
+    }
+
+    /**
+     * Writes [items] as DecSync updates and makes them the known items. Mostly used during an
+     * initial sync.
+     */
+    fun initSync(items: Iterable<DecsyncItem>) = executor.execute {
+        hashes.clear()
+        val updates = DecsyncUpdates()
+        for (item in items) {
+            hashes[key(item)] = hash(item)
+            updates.addInsertion(item)
+        }
+        updates.apply(this::setEntries, this::executeStoredEntries, false)
+    }
+
+    /**
+     * Inserts or updates [items]. Items with the same entries as before are skipped.
+     *
+     * @param isFromDecsyncListener see [DecsyncObserver.updateList].
+     */
+    fun upsert(items: Iterable<DecsyncItem>, isFromDecsyncListener: Boolean = false) = executor.execute {
+        val updates = DecsyncUpdates()
+        for (item in items) {
+            val key = key(item)
+            val hash = hash(item)
+            val oldHash = hashes.put(key, hash)
+            when (oldHash) {
+                null -> updates.addInsertion(item)
+                hash -> {}
+                else -> updates.addChange(null, item)
+            }
+        }
+        if (isDecsyncEnabled()) {
+            updates.apply(this::setEntries, this::executeStoredEntries, isFromDecsyncListener)
+        }
+    }
+
+    /**
+     * Deletes [items]. Unknown items are skipped.
+     *
+     * @param isFromDecsyncListener see [DecsyncObserver.updateList].
+     */
+    fun delete(items: Iterable<DecsyncItem>, isFromDecsyncListener: Boolean = false) = executor.execute {
+        val updates = DecsyncUpdates()
+        for (item in items) {
+            if (hashes.remove(key(item)) != null) {
+                updates.addDeletion(item)
+            }
+        }
+        if (isDecsyncEnabled()) {
+            updates.apply(this::setEntries, this::executeStoredEntries, isFromDecsyncListener)
+        }
+    }
+
+    /**
+     * Waits until all previous updates are written.
+     */
+    fun flush() = executor.flush()
+
+    private fun key(item: DecsyncItem): Pair<String, Comparable<*>> = Pair(item.type, item.id)
+
+    companion object {
+        private const val FNV_OFFSET = -0x340d631b7bdddcdbL
+        private const val FNV_PRIME = 0x100000001b3L
+
+        private fun fnv(hash: Long, text: String): Long {
+            var result = hash
+            for (c in text) {
+                result = (result xor c.code.toLong()) * FNV_PRIME
+            }
+            return result
+        }
+
+        // Finalizer of SplitMix64, such that similar entries do not cancel out in the sum
+        private fun mix(hash: Long): Long {
+            var z = hash
+            z = (z xor (z ushr 30)) * -0x40a7b892e31b1a47L
+            z = (z xor (z ushr 27)) * -0x6b2fb644ecceee15L
+            return z xor (z ushr 31)
+        }
+
+        /**
+         * Returns a 64-bit hash of the entries of [item]. It is independent of the order of the
+         * entries and uses the same notion of equality as [DecsyncItem.Value]: JSON objects are
+         * hashed independently of the order of their members, and references by the type and hash
+         * code of their internalId, as only its equality is known.
+         */
+        internal fun hash(item: DecsyncItem): Long {
+            var result = 0L
+            for ((storedEntry, value) in item.entries) {
+                var hash = fnv(FNV_OFFSET, storedEntry.path.joinToString("\u0000"))
+                hash = fnv(hash, "\u0001${JsonText.sortedText(storedEntry.key)}\u0001")
+                hash = when (value) {
+                    is DecsyncItem.Value.Normal -> fnv(hash, "N${JsonText.sortedText(value.value)}")
+                    is DecsyncItem.Value.Reference -> {
+                        val internalId = value.internalId
+                        fnv(hash, "R${internalId?.let { it::class.qualifiedName }}:${internalId.hashCode()}")
+                    }
+                }
+                result += mix(hash)
+            }
+            return result
+        }
+    }
+}
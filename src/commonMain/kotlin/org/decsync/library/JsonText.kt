@@ -0,0 +1,241 @@
+/**
+ * libdecsync - JsonText.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlinx.serialization.json.*
+
+/**
+ * A JSON value which is kept as its serialized [text] as long as possible. The [element] is only
+ * built when it is actually requested, as reading from and writing to the DecSync files only
+ * requires the text.
+ *
+ * The text is always canonical, i.e. equal to the serialization of the element. Values without
+ * objects of multiple members are therefore compared by their text. The others are compared by
+ * their element, as the order of the members is ignored by [JsonObject.equals].
+ */
+internal class JsonText private constructor(
+        val text: String,
+        private var mElement: JsonElement?,
+        val isOrdered: Boolean
+) {
+    constructor(element: JsonElement) : this(element.toString(), element, isOrdered(element))
+
+    val element: JsonElement
+        get() = mElement ?: json.parseToJsonElement(text).also { mElement = it }
+
+    /**
+     * Returns the content of a JSON string without building the element, or null if this value is
+     * not a string.
+     */
+    fun stringContent(): String? {
+        if (text.isEmpty() || text[0] != '"') return null
+        if (text.indexOf('\\') < 0) return text.substring(1, text.length - 1)
+        return element.jsonPrimitive.content
+    }
+
+    override fun equals(other: Any?): Boolean {
+        if (other === this) return true
+        if (other == null || other !is JsonText) return false
+        return if (isOrdered && other.isOrdered) text == other.text else element == other.element
+    }
+
+    override fun hashCode(): Int = if (isOrdered) text.hashCode() else element.hashCode()
+
+    override fun toString(): String = text
+
+    companion object {
+        /**
+         * Returns the [JsonText] corresponding to [text]. If [text] is already canonical, it is
+         * used unchanged and no element is built. Otherwise, it is parsed and serialized again.
+         *
+         * @throws Exception if [text] is not valid JSON.
+         */
+        fun fromText(text: String): JsonText {
+            val scanner = Scanner(text)
+            if (scanner.value() && scanner.pos == text.length) {
+                return JsonText(text, null, scanner.isOrdered)
+            }
+            return JsonText(json.parseToJsonElement(text))
+        }
+
+        /**
+         * Splits the canonical JSON array [text] into its items without building any element.
+         * Returns null if [text] is not a canonical JSON array.
+         */
+        fun splitArray(text: String): List<JsonText>? {
+            val scanner = Scanner(text)
+            if (!scanner.consume('[')) return null
+            val items = mutableListOf<JsonText>()
+            if (scanner.consume(']')) {
+                return if (scanner.pos == text.length) items else null
+            }
+            do {
+                val start = scanner.pos
+                scanner.isOrdered = true
+                if (!scanner.value()) return null
+                items += JsonText(text.substring(start, scanner.pos), null, scanner.isOrdered)
+            } while (scanner.consume(','))
+            if (!scanner.consume(']') || scanner.pos != text.length) return null
+            return items
+        }
+
+        /**
+         * Returns the serialization of [element] with the members of every object sorted by name.
+         * Unlike [text], it is the same for all equal elements, so it can be used for hashing.
+         */
+        fun sortedText(element: JsonElement): String = when (element) {
+            is JsonPrimitive -> element.toString()
+            is JsonArray -> element.joinToString(",", "[", "]") { sortedText(it) }
+            is JsonObject -> element.entries.sortedBy { it.key }.joinToString(",", "{", "}") { (name, value) ->
+                "${JsonPrimitive(name)}:${sortedText(value)}"
+            }
+        }
+
+        private fun isOrdered(element: JsonElement): Boolean = when (element) {
+            is JsonPrimitive -> true
+            is JsonArray -> element.all { isOrdered(it) }
+            is JsonObject -> element.size <= 1 && element.values.all { isOrdered(it) }
+        }
+    }
+
+    /**
+     * Validating scanner for canonical JSON, which is JSON as serialized by kotlinx.serialization:
+     * no whitespace outside strings and only the escape sequences used by its serializer.
+     */
+    private class Scanner(private val text: String) {
+        var pos = 0
+        var isOrdered = true
+
+        fun consume(c: Char): Boolean {
+            if (pos >= text.length || text[pos] != c) return false
+            pos++
+            return true
+        }
+
+        fun value(): Boolean {
+            if (pos >= text.length) return false
+            return when (text[pos]) {
+                '"' -> string()
+                '[' -> array()
+                '{' -> obj()
+                't' -> literal("true")
+                'f' -> literal("false")
+                'n' -> literal("null")
+                else -> number()
+            }
+        }
+
+        private fun literal(name: String): Boolean {
+            if (!text.startsWith(name, pos)) return false
+            pos += name.length
+            return true
+        }
+
+        private fun array(): Boolean {
+            pos++
+            if (consume(']')) return true
+            do {
+                if (!value()) return false
+            } while (consume(','))
+            return consume(']')
+        }
+
+        private fun obj(): Boolean {
+            pos++
+            if (consume('}')) return true
+            val names = mutableListOf<String>()
+            do {
+                val start = pos
+                if (!string()) return false
+                val name = text.substring(start, pos)
+                // Duplicate names are not preserved by the serializer
+                if (name in names) return false
+                names += name
+                if (!consume(':')) return false
+                if (!value()) return false
+            } while (consume(','))
+            if (names.size > 1) {
+                isOrdered = false
+            }
+            return consume('}')
+        }
+
+        private fun string(): Boolean {
+            pos++
+            while (pos < text.length) {
+                val c = text[pos++]
+                when {
+                    c == '"' -> return true
+                    c < ' ' -> return false
+                    c == '\\' -> if (!escape()) return false
+                }
+            }
+            return false
+        }
+
+        private fun escape(): Boolean {
+            if (pos >= text.length) return false
+            return when (text[pos++]) {
+                '"', '\\', 'b', 't', 'n', 'f', 'r' -> true
+                'u' -> {
+                    // Only control characters without a short escape are written as \u00xx
+                    if (!text.startsWith("00", pos) || pos + 4 > text.length) return false
+                    val high = text[pos + 2]
+                    val low = text[pos + 3]
+                    pos += 4
+                    val lowValue = when (low) {
+                        in '0'..'9' -> low - '0'
+                        in 'a'..'f' -> low - 'a' + 10
+                        else -> return false
+                    }
+                    val value = when (high) {
+                        '0' -> lowValue
+                        '1' -> 16 + lowValue
+                        else -> return false
+                    }
+                    value != 0x08 && value != 0x09 && value != 0x0a && value != 0x0c && value != 0x0d
+                }
+                else -> false
+            }
+        }
+
+        private fun number(): Boolean {
+            consume('-')
+            if (consume('0')) {
+                // No leading zeros
+            } else if (!digits()) {
+                return false
+            }
+            if (consume('.') && !digits()) return false
+            if (consume('e') || consume('E')) {
+                if (!consume('+')) consume('-')
+                if (!digits()) return false
+            }
+            return true
+        }
+
+        private fun digits(): Boolean {
+            val start = pos
+            while (pos < text.length && text[pos] in '0'..'9') {
+                pos++
+            }
+            return pos > start
+        }
+    }
+}
@@ -25,10 +25,23 @@ sealed class RealNode(name: String) : FileSystemNode(name)
 abstract class RealFile(name: String) : RealNode(name) {
     abstract fun delete()
     abstract fun length(): Int
-    abstract fun read(readBytes: Int = 0): ByteArray
+    // Reads at most [maxLength] bytes, skipping the first [readBytes] bytes
+    abstract fun read(readBytes: Int = 0, maxLength: Int = Int.MAX_VALUE): ByteArray
     abstract fun write(text: ByteArray, append: Boolean = false)
+
+    /**
+     * Returns the index of the keys in this file, or null if the file system does not keep such an
+     * index. It has to be requested before the file is read.
+     */
+    open fun keyIndex(): KeyIndex? = null
 }
 
+/**
+ * The JSON texts of the keys in a file, if they are known and the file is unchanged since. Otherwise,
+ * the keys are [update]d after reading the file.
+ */
+class KeyIndex(val keys: Set<String>?, val update: (Set<String>) -> Unit)
+
 abstract class RealDirectory(name: String) : RealNode(name) {
     protected abstract fun listChildren(): List<RealNode>
     abstract fun delete()
@@ -90,9 +103,9 @@ class NativeFile constructor(
         }
     }
 
-    fun read(readBytes: Int = 0): ByteArray? {
+    fun read(readBytes: Int = 0, maxLength: Int = Int.MAX_VALUE): ByteArray? {
         return when (val node = fileSystemNode) {
-            is RealFile -> node.read(readBytes).also { bytes ->
+            is RealFile -> node.read(readBytes, maxLength).also { bytes ->
                 // There should never be an empty file
                 // It probably means that an (uncaught) error occurred
                 if (readBytes == 0 && bytes.isEmpty()) {
@@ -104,6 +117,8 @@ class NativeFile constructor(
         }
     }
 
+    fun keyIndex(): KeyIndex? = (fileSystemNode as? RealFile)?.keyIndex()
+
     fun write(text: ByteArray, append: Boolean = false) {
         when (val node = fileSystemNode) {
             is RealFile -> {
@@ -0,0 +1,58 @@
+/**
+ * libdecsync - PathTable.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+/**
+ * Table of interned paths. Items usually share a small number of distinct paths, so every path
+ * is only stored once. Interned paths cache their hash code and equal interned paths are
+ * identical, which makes grouping and comparing entries by their path cheap.
+ *
+ * Paths are never removed from the table, so only paths from a bounded set should be interned.
+ */
+internal object PathTable {
+    private val lock = ReadWriteLock()
+    private val paths = HashMap<List<String>, Path>()
+
+    fun intern(path: List<String>): List<String> {
+        if (path is Path) return path
+        return lock.read { paths[path] } ?: lock.write {
+            // Key on the immutable copy, the caller's list may be mutated later
+            val interned = Path(path.toTypedArray())
+            paths.getOrPut(interned) { interned }
+        }
+    }
+
+    private class Path(private val segments: Array<String>) : AbstractList<String>() {
+        private val hash = segments.contentHashCode()
+
+        override val size: Int
+            get() = segments.size
+
+        override fun get(index: Int): String = segments[index]
+
+        override fun hashCode(): Int = hash
+
+        override fun equals(other: Any?): Boolean {
+            if (other === this) return true
+            // Equal paths in the table are identical
+            if (other is Path) return false
+            return super.equals(other)
+        }
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ * libdecsync - ReadWriteLock.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+/**
+ * Reader/writer lock backed by the lock of the platform. Multiple readers can hold the lock at the
+ * same time, while a writer holds it exclusively. The lock is not reentrant.
+ */
+internal expect class ReadWriteLock() {
+    fun <R> read(action: () -> R): R
+    fun <R> write(action: () -> R): R
+
+    /**
+     * Releases the native resources. The lock cannot be used afterwards.
+     */
+    fun dispose()
+}
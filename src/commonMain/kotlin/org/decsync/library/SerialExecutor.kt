@@ -0,0 +1,35 @@
+/**
+ * libdecsync - SerialExecutor.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+/**
+ * Executes tasks in the background, one at a time and in the order in which they are submitted.
+ * The threads are shared with other executors.
+ */
+internal expect class SerialExecutor() {
+    fun execute(f: () -> Unit)
+
+    /**
+     * Waits until all submitted tasks are completed. Must not be called from a task of any
+     * executor, as the threads are shared. On native platforms, this throws an
+     * [IllegalStateException] if the calling task would otherwise wait for itself.
+     */
+    fun flush()
+}
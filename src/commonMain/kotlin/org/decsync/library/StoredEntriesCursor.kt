@@ -0,0 +1,49 @@
+/**
+ * libdecsync - StoredEntriesCursor.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+/**
+ * Pull-based cursor over stored entries, opened by [Decsync.openStoredEntriesCursor]. Every call
+ * to [next] returns the next entry, or null when all entries are read. Files are only read once
+ * their first entry is requested, so a cursor which is closed early does not read the remaining
+ * files. A cursor must only be used by one thread at a time.
+ */
+@ExperimentalStdlibApi
+class StoredEntriesCursor internal constructor(entries: Sequence<Decsync.EntryWithPath>) {
+    private var iterator: Iterator<Decsync.EntryWithPath>? = entries.iterator()
+
+    /**
+     * Returns the next stored entry, or null if there are no more entries or the cursor is closed.
+     */
+    fun next(): Decsync.EntryWithPath? {
+        val iterator = iterator ?: return null
+        if (!iterator.hasNext()) {
+            close()
+            return null
+        }
+        return iterator.next()
+    }
+
+    /**
+     * Closes the cursor, releasing its position in the stored entries.
+     */
+    fun close() {
+        iterator = null
+    }
+}
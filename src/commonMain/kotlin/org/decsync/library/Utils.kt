@@ -20,5 +20,4 @@ package org.decsync.library
 
 expect fun getDeviceName(): String
 expect fun currentDatetime(): String
-expect fun byteArrayToString(input: ByteArray): String
-expect fun async(f: () -> Unit)
\ No newline at end of file
+expect fun byteArrayToString(input: ByteArray): String
\ No newline at end of file
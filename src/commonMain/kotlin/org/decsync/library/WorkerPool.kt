@@ -0,0 +1,35 @@
+/**
+ * libdecsync - WorkerPool.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+/**
+ * A fixed number of threads on which tasks can be executed in parallel.
+ */
+internal expect class WorkerPool(size: Int) {
+    val size: Int
+
+    /**
+     * Executes all [tasks] and waits until they are completed. If a task throws an exception, the
+     * other tasks are still executed and the first exception is thrown afterwards.
+     */
+    fun runAll(tasks: List<() -> Unit>)
+
+    fun close()
+}
@@ -6,9 +6,16 @@ import org.decsync.library.Decsync.StoredEntry
 import org.decsync.library.DecsyncItem
 import org.decsync.library.DecsyncItem.Value.Normal
 import org.decsync.library.DecsyncItem.Value.Reference
+import org.decsync.library.PathTable
 
 @ExperimentalStdlibApi
 object Rss {
+    private val feedsSubscriptionsPath = PathTable.intern(listOf("feeds", "subscriptions"))
+    private val feedsNamesPath = PathTable.intern(listOf("feeds", "names"))
+    private val feedsCategoriesPath = PathTable.intern(listOf("feeds", "categories"))
+    private val categoriesNamesPath = PathTable.intern(listOf("categories", "names"))
+    private val categoriesParentsPath = PathTable.intern(listOf("categories", "parents"))
+
     open class Article(
             guid: String,
             read: Boolean,
@@ -31,7 +38,7 @@ object Rss {
             val yearString = year.toString()
             val monthString = month.toString().padStart(2, '0')
             val dayString = day.toString().padStart(2, '0')
-            return listOf("articles", type, yearString, monthString, dayString)
+            return PathTable.intern(listOf("articles", type, yearString, monthString, dayString))
         }
     }
 
@@ -43,11 +50,11 @@ object Rss {
     ) : DecsyncItem {
         override val type = "RssFeed"
         override val id = link
-        override val idStoredEntry = StoredEntry(listOf("feeds", "subscriptions"), JsonPrimitive(link))
+        override val idStoredEntry = StoredEntry(feedsSubscriptionsPath, JsonPrimitive(link))
         override val entries = mapOf(
-                StoredEntry(listOf("feeds", "names"), JsonPrimitive(link)) to
+                StoredEntry(feedsNamesPath, JsonPrimitive(link)) to
                         Normal(JsonPrimitive(name), JsonNull),
-                StoredEntry(listOf("feeds", "categories"), JsonPrimitive(link)) to
+                StoredEntry(feedsCategoriesPath, JsonPrimitive(link)) to
                         Reference(internalCatId) { JsonPrimitive(category()) }
         )
     }
@@ -62,9 +69,9 @@ object Rss {
         override val id = catId
         override val idStoredEntry: StoredEntry? = null
         override val entries = mapOf(
-                StoredEntry(listOf("categories", "names"), JsonPrimitive(catId)) to
+                StoredEntry(categoriesNamesPath, JsonPrimitive(catId)) to
                         Normal(JsonPrimitive(name), JsonPrimitive(catId)),
-                StoredEntry(listOf("categories", "parents"), JsonPrimitive(catId)) to
+                StoredEntry(categoriesParentsPath, JsonPrimitive(catId)) to
                         Reference(internalParentId) { JsonPrimitive(parent()) }
 
         )
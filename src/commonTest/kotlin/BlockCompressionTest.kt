@@ -0,0 +1,29 @@
+package org.decsync.library
+
+import kotlin.test.*
+
+class BlockCompressionTest {
+    @Test
+    fun roundTrip() {
+        val lines = (0 until 1000).joinToString("") { "[\"2020-08-23T00:00:${it % 60}\",\"guid$it\",true]\n" }
+        val inputs = listOf(
+                ByteArray(0),
+                "a".encodeToByteArray(),
+                "abababababababababababab".encodeToByteArray(),
+                ByteArray(1000) { 0 },
+                ByteArray(1000) { (it * 7919 % 251).toByte() },
+                lines.encodeToByteArray()
+        )
+        for (input in inputs) {
+            val compressed = BlockCompression.compress(input)
+            assertContentEquals(input, BlockCompression.decompress(compressed, input.size))
+        }
+        assertTrue(BlockCompression.compress(lines.encodeToByteArray()).size < lines.length / 2)
+    }
+
+    @Test
+    fun invalidBlock() {
+        val compressed = BlockCompression.compress("abcdabcdabcd".encodeToByteArray())
+        assertFails { BlockCompression.decompress(compressed, 13) }
+    }
+}
@@ -6,6 +6,8 @@ import kotlin.test.AfterTest
 import kotlin.test.BeforeTest
 import kotlin.test.Test
 import kotlin.test.assertEquals
+import kotlin.test.assertFalse
+import kotlin.test.assertTrue
 
 // Always return the same mock dir, as different instances cannot communicate
 @ExperimentalStdlibApi
@@ -132,6 +134,177 @@ abstract class DecsyncTest(
         assertEquals(listOf(datetime1), extra)
     }
 
+    @Test
+    fun bulkSet() {
+        val decsync1 = getDecsync("app-id-1")
+        val decsync2 = getDecsync("app-id-2")
+        val path1 = listOf("path1")
+        val path2 = listOf("path2", "sub")
+        val key = JsonPrimitive("key")
+        val value1 = JsonPrimitive("value1")
+        val value2 = JsonPrimitive("value2")
+
+        decsync1.setEntry(path1, key, value1)
+        decsync2.executeAllNewEntries(extra2)
+        extra2.clear()
+        decsync1.setEntries(listOf(
+                Decsync.EntryWithPath(path2, key, value2),
+                Decsync.EntryWithPath(path1, key, value1)
+        ))
+        checkStoredEntry(decsync1, path1, key, value1)
+        checkStoredEntry(decsync1, path2, key, value2)
+        decsync2.executeAllNewEntries(extra2)
+        // The unchanged value is not written again
+        checkExtra(extra2, path1, key, null)
+        checkExtra(extra2, path2, key, value2)
+    }
+
+    @Test
+    fun executeStoredEntriesOfMultiplePaths() {
+        val decsync = getDecsync()
+        val path1 = listOf("path1")
+        val path2 = listOf("path2")
+        val key1 = JsonPrimitive("key1")
+        val key2 = JsonPrimitive("key2")
+        decsync.setEntries(listOf(
+                Decsync.EntryWithPath(path1, key1, JsonPrimitive("value1")),
+                Decsync.EntryWithPath(path1, key2, JsonPrimitive("value2")),
+                Decsync.EntryWithPath(path2, key1, JsonPrimitive("value3"))
+        ))
+        decsync.executeStoredEntries(listOf(
+                Decsync.StoredEntry(path1, key1),
+                Decsync.StoredEntry(path2, key1),
+                Decsync.StoredEntry(path2, key2),
+                Decsync.StoredEntry(listOf("path3"), key1)
+        ), extra1)
+        assertEquals(mapOf(
+                path1 to mutableMapOf<JsonElement, JsonElement>(key1 to JsonPrimitive("value1")),
+                path2 to mutableMapOf<JsonElement, JsonElement>(key1 to JsonPrimitive("value3"))
+        ), extra1)
+    }
+
+    @Test
+    fun storedEntriesCursor() {
+        val decsync = getDecsync()
+        val key = JsonPrimitive("key")
+        decsync.setEntries(listOf(
+                Decsync.EntryWithPath(listOf("foo", "b"), key, JsonPrimitive("value1")),
+                Decsync.EntryWithPath(listOf("foo", "a", "d"), key, JsonPrimitive("value2")),
+                Decsync.EntryWithPath(listOf("foo", "a", "c"), key, JsonPrimitive("value3")),
+                Decsync.EntryWithPath(listOf("bar"), key, JsonPrimitive("value4"))
+        ))
+
+        val cursor = decsync.openStoredEntriesCursor(listOf("foo"))
+        val paths = generateSequence { cursor.next() }.map { it.path }.toList()
+        assertEquals(listOf(listOf("foo", "a", "c"), listOf("foo", "a", "d"), listOf("foo", "b")), paths)
+
+        val closedCursor = decsync.openStoredEntriesCursor(emptyList())
+        assertEquals(listOf("bar"), closedCursor.next()?.path)
+        closedCursor.close()
+        assertEquals(null, closedCursor.next())
+    }
+
+    @Test
+    fun newEntriesSequence() {
+        val decsync1 = getDecsync("app-id-1")
+        val decsync2 = getDecsync("app-id-2")
+        val path1 = listOf("path1")
+        val path2 = listOf("path2")
+        val key = JsonPrimitive("key")
+        decsync1.setEntries(listOf(
+                Decsync.EntryWithPath(path1, key, JsonPrimitive("value1")),
+                Decsync.EntryWithPath(path2, key, JsonPrimitive("value2"))
+        ))
+
+        // A batch which is not followed by a request for the next one is returned again
+        val first = decsync2.newEntries().first()
+        assertEquals(first, decsync2.newEntries().first())
+
+        val batches = decsync2.newEntries().toList()
+        assertEquals(setOf(path1, path2), batches.map { it.single().path }.toSet())
+        assertEquals(emptyList(), decsync2.newEntries().toList())
+        checkStoredEntry(decsync2, path2, key, JsonPrimitive("value2"))
+        assertEquals(listOf(path1, path2), decsync2.storedEntries(emptyList()).map { it.path }.toList())
+    }
+
+    @Test
+    fun changesSince() {
+        val decsync1 = getDecsync("app-id-1")
+        val decsync2 = getDecsync("app-id-2")
+        val path1 = listOf("path1")
+        val path2 = listOf("path2")
+        val key = JsonPrimitive("key")
+        // Nothing is journaled before the first watermark
+        decsync2.setEntry(listOf("path0"), key, JsonPrimitive("value0"))
+        assertTrue(decsync2.changesSince(0).isStale)
+        val watermark0 = decsync2.currentChangesWatermark()
+
+        decsync1.setEntry(path1, key, JsonPrimitive("value1"))
+        decsync2.executeAllNewEntries(extra2)
+        val changes1 = decsync2.changesSince(watermark0)
+        assertEquals(listOf(path1 to JsonPrimitive("value1")), changes1.entries.map { it.path to it.entry.value })
+
+        decsync2.setEntry(path2, key, JsonPrimitive("value2"))
+        val changes2 = decsync2.changesSince(changes1.watermark)
+        assertEquals(listOf(path2 to JsonPrimitive("value2")), changes2.entries.map { it.path to it.entry.value })
+        assertEquals(emptyList(), decsync2.changesSince(changes2.watermark).entries)
+        assertFalse(changes2.isStale)
+
+        // A watermark of another generation or past the end of the journal is stale
+        val stale1 = decsync2.changesSince(changes2.watermark xor (1L shl 40))
+        assertTrue(stale1.isStale)
+        assertEquals(changes2.watermark, stale1.watermark)
+        assertTrue(decsync2.changesSince(changes2.watermark + 1000).isStale)
+    }
+
+    @Test
+    fun exportImportArchive() {
+        val decsync1 = getDecsync("app-id-1", "collection1")
+        val path = listOf("path", "unicode \u263A")
+        val key = JsonPrimitive("key")
+        val value = JsonPrimitive("value")
+        decsync1.currentChangesWatermark()
+        decsync1.setEntry(path, key, value)
+
+        val archive = dirFactory().child("archive")
+        Decsync.exportArchive(dirFactory(), "sync-type", "collection1", archive)
+        Decsync.importArchive(dirFactory(), "sync-type", "collection2", archive)
+        checkStoredEntry(getDecsync("app-id-1", "collection2"), path, key, value)
+        // The change journal is a local cache, so it is not restored
+        assertEquals(-1L, getDecsync("app-id-1", "collection2").changesSince(0).watermark)
+
+        Decsync.exportArchive(dirFactory(), "sync-type", "collection1", archive, "app-id-2")
+        Decsync.importArchive(dirFactory(), "sync-type", "collection3", archive)
+        // The info of other apps is not included either
+        assertEquals("app-id-3", getDecsync("app-id-3", "collection3").latestAppId())
+        checkStoredEntry(getDecsync("app-id-1", "collection3"), path, key, null)
+    }
+
+    @Test
+    fun maintenance() {
+        val decsync1 = getDecsync("app-id-1")
+        val decsync2 = getDecsync("app-id-2")
+        val path = listOf("path")
+        val key = JsonPrimitive("key")
+        decsync1.setEntriesForPath(path, listOf(Decsync.Entry("2020-08-23T00:00:00", key, JsonPrimitive("value1"))))
+        decsync1.setEntriesForPath(path, listOf(Decsync.Entry("2020-08-23T00:00:01", key, JsonPrimitive("value2"))))
+        decsync2.executeAllNewEntries(extra2)
+
+        val stats = DecsyncMaintenance.stats(dirFactory(), "sync-type", null, 2)
+                .single { it.kind == "new-entries" && it.appId == "app-id-1" && it.path == path }
+        assertEquals(2, stats.entries)
+        assertEquals(1, stats.deadEntries)
+        assertEquals(emptyList(), DecsyncMaintenance.verify(dirFactory(), "sync-type", null, 2))
+        assertEquals(0, DecsyncMaintenance.lag(dirFactory(), "sync-type", null, 2)
+                .single { it.appId == "app-id-2" && it.peerAppId == "app-id-1" }.unreadBytes)
+
+        assertEquals(1, DecsyncMaintenance.compact(dirFactory(), "sync-type", null, "app-id-1", 2))
+        assertEquals(emptyList(), DecsyncMaintenance.verify(dirFactory(), "sync-type", null, 2))
+        decsync1.setEntriesForPath(path, listOf(Decsync.Entry("2020-08-23T00:00:02", key, JsonPrimitive("value3"))))
+        decsync2.executeAllNewEntries(extra2)
+        checkStoredEntry(decsync2, path, key, JsonPrimitive("value3"))
+    }
+
     @Test
     fun listCollections() {
         assertEquals(emptyList(), listDecsyncCollections(dirFactory(), "sync-type"))
@@ -143,6 +316,56 @@ abstract class DecsyncTest(
         assertEquals(collections.toSet().size, collections.size)
     }
 
+    @Test
+    fun managerExecutesAllCollections() {
+        val collections = listOf("foo", "bar", "baz")
+        val path = listOf("path")
+        val key = JsonPrimitive("key")
+        for (collection in collections) {
+            getDecsync("app-id-1", collection).setEntry(path, key, JsonPrimitive(collection))
+        }
+        val manager = DecsyncManager<Extra>(dirFactory(), "sync-type", "app-id-2", 2) { _, decsync ->
+            decsync.addListener(emptyList()) { entryPath, entry, extra ->
+                val map = extra.getOrPut(entryPath) { mutableMapOf() }
+                map[entry.key] = entry.value
+            }
+        }
+        assertEquals(collections.toSet(), manager.decsyncs.keys)
+        val extras = collections.associateWith { mutableMapOf<List<String>, MutableMap<JsonElement, JsonElement>>() }
+        manager.executeAllNewEntries { extras.getValue(it) }
+        for (collection in collections) {
+            checkExtra(extras.getValue(collection), path, key, JsonPrimitive(collection))
+        }
+        manager.close()
+    }
+
+    @Test
+    fun readerMergesAllApps() {
+        val decsync1 = getDecsync("app-id-1")
+        val decsync2 = getDecsync("app-id-2")
+        // A path is either a file or a directory, so the prefix walk uses a sibling path
+        val path = listOf("dir", "path")
+        val subPath = listOf("dir", "sub")
+        val key1 = JsonPrimitive("key1")
+        val key2 = JsonPrimitive("key2")
+        decsync1.setEntriesForPath(path, listOf(Decsync.Entry("2020-08-23T00:00:01", key1, JsonPrimitive("value1"))))
+        decsync2.setEntriesForPath(path, listOf(Decsync.Entry("2020-08-23T00:00:00", key1, JsonPrimitive("old"))))
+        decsync2.setEntry(subPath, key2, JsonPrimitive("value2"))
+
+        val reader = DecsyncReader(dirFactory(), "sync-type", null)
+        assertEquals(JsonPrimitive("value1"), reader.getStoredEntry(path, key1)?.value)
+        assertEquals(null, reader.getStoredEntry(path, key2))
+        assertEquals(listOf(key1), reader.getStoredEntriesForPathExact(path).map { it.key })
+        assertEquals(
+                setOf(Triple(path, key1, JsonPrimitive("value1")), Triple(subPath, key2, JsonPrimitive("value2"))),
+                reader.getStoredEntriesForPathPrefix(listOf("dir")).map { Triple(it.path, it.entry.key, it.entry.value) }.toSet()
+        )
+
+        // The info entries maintained by the library are not returned
+        decsync1.executeAllNewEntries(extra1)
+        assertEquals(emptyList(), reader.getStoredEntriesForPathExact(listOf("info")))
+    }
+
     @Test
     fun staticInfo() {
         assertEquals(
@@ -0,0 +1,66 @@
+package org.decsync.library
+
+import kotlin.random.Random
+import kotlin.test.Test
+import kotlin.test.assertEquals
+
+class DiffTest {
+    private val comparator = compareBy<Pair<Int, Int>> { it.first }
+
+    // Sorted lists with about a quarter of the identifiers inserted, deleted and changed each
+    private fun lists(size: Int, random: Random): Pair<List<Pair<Int, Int>>, List<Pair<Int, Int>>> {
+        val oldList = mutableListOf<Pair<Int, Int>>()
+        val newList = mutableListOf<Pair<Int, Int>>()
+        for (id in 0 until size) {
+            when (random.nextInt(4)) {
+                0 -> newList += id to 0
+                1 -> oldList += id to 0
+                2 -> {
+                    oldList += id to 0
+                    newList += id to 1
+                }
+                else -> {
+                    oldList += id to 0
+                    newList += id to 0
+                }
+            }
+        }
+        return oldList to newList
+    }
+
+    @Test
+    fun calc() {
+        val oldList = listOf(1 to 0, 2 to 0, 4 to 0, 5 to 0)
+        val newList = listOf(0 to 0, 2 to 1, 3 to 0, 4 to 0)
+        val result = Diff.calc(oldList, newList, comparator)
+        assertEquals(listOf(0 to 0, 3 to 0), result.insertions)
+        assertEquals(listOf(1 to 0, 5 to 0), result.deletions)
+        assertEquals(listOf((2 to 0) to (2 to 1)), result.changes)
+    }
+
+    @Test
+    fun parallelEqualsSequential() {
+        val random = Random(0)
+        for (size in listOf(0, 10, 100_000, 300_000)) {
+            val (oldList, newList) = lists(size, random)
+            val expected = Diff.calc(oldList, newList, comparator)
+            assertEquals(expected, Diff.calc(oldList, newList, comparator, 4))
+            assertEquals(Diff.Result(newList, emptyList(), emptyList()), Diff.calc(emptyList(), newList, comparator, 4))
+            assertEquals(Diff.Result(emptyList(), oldList, emptyList()), Diff.calc(oldList, emptyList(), comparator, 4))
+        }
+    }
+
+    @Test
+    fun reusedPool() {
+        val random = Random(1)
+        val pool = WorkerPool(4)
+        try {
+            repeat(3) {
+                val (oldList, newList) = lists(100_000, random)
+                assertEquals(Diff.calc(oldList, newList, comparator), Diff.calc(oldList, newList, comparator, pool))
+            }
+        } finally {
+            pool.close()
+        }
+    }
+}
@@ -0,0 +1,45 @@
+package org.decsync.library
+
+import kotlinx.serialization.json.JsonPrimitive
+import kotlin.test.*
+
+@ExperimentalStdlibApi
+class FlagCodecTest {
+    @Test
+    fun roundTrip() {
+        val lines = listOf(
+                "[\"2020-08-23T00:00:00\",\"guid\",true]",
+                "[\"2020-08-23T00:00:00\",\"guid \\\" ☺\",false]",
+                "[\"2020-08-23T00:00:00\",\"guid\",\"value\"]"
+        )
+        val codec = FlagCodec()
+        for (line in lines) {
+            val entry = codec.fromLine(line)!!
+            assertEquals(Decsync.Entry.fromLine(line), entry)
+            assertEquals(line, FlagCodec.toLine(entry))
+        }
+    }
+
+    @Test
+    fun sharedDatetime() {
+        val codec = FlagCodec()
+        val entry1 = codec.fromLine("[\"2020-08-23T00:00:00\",\"guid1\",true]")!!
+        val entry2 = codec.fromLine("[\"2020-08-23T00:00:00\",\"guid2\",false]")!!
+        val entry3 = codec.fromLine("[\"2020-08-23T00:00:01\",\"guid3\",false]")!!
+        assertSame(entry1.datetime, entry2.datetime)
+        assertEquals("2020-08-23T00:00:01", entry3.datetime)
+        assertEquals(Decsync.Entry("2020-08-23T00:00:01", JsonPrimitive("guid3"), JsonPrimitive(false)), entry3)
+    }
+
+    @Test
+    fun invalidFallsBack() {
+        val codec = FlagCodec()
+        assertNull(codec.fromLine("[\"2020-08-23T00:00:00\",\"a\",\"b\",true]"))
+        assertNull(codec.fromLine("[\"2020-08-23T00:00:00\",true]"))
+        assertNull(codec.fromLine("true]"))
+        assertEquals(
+                Decsync.Entry("2020-08-23T00:00:00", JsonPrimitive("guid"), JsonPrimitive(true)),
+                codec.fromLine("[\"2020-08-23T00:00:00\", \"guid\", true]")
+        )
+    }
+}
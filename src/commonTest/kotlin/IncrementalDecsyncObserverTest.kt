@@ -0,0 +1,115 @@
+package org.decsync.library
+
+import kotlinx.serialization.json.*
+import kotlin.test.*
+
+@ExperimentalStdlibApi
+class IncrementalDecsyncObserverTest {
+    private class Item(override val id: String, value: JsonElement, internalRef: Any? = null) : DecsyncItem {
+        override val type = "Item"
+        override val idStoredEntry = Decsync.StoredEntry(listOf("ids"), JsonPrimitive(id))
+        override val entries = mapOf(
+                Decsync.StoredEntry(listOf("values"), JsonPrimitive(id)) to
+                        DecsyncItem.Value.Normal(value, JsonNull),
+                Decsync.StoredEntry(listOf("refs"), JsonPrimitive(id)) to
+                        DecsyncItem.Value.Reference(internalRef) { JsonPrimitive(internalRef?.toString()) }
+        )
+    }
+
+    private class Observer : IncrementalDecsyncObserver() {
+        private val entries = mutableListOf<Decsync.EntryWithPath>()
+
+        override fun isDecsyncEnabled(): Boolean = true
+        override fun setEntries(entries: List<Decsync.EntryWithPath>) {
+            this.entries += entries
+        }
+        override fun executeStoredEntries(storedEntries: List<Decsync.StoredEntry>) {}
+
+        // Returns the written entries without their datetimes
+        fun takeEntries(): Set<Triple<List<String>, JsonElement, JsonElement>> {
+            flush()
+            val result = entries.map { Triple(it.path, it.entry.key, it.entry.value) }.toSet()
+            entries.clear()
+            return result
+        }
+    }
+
+    @Test
+    fun insert() {
+        val observer = Observer()
+        observer.upsert(listOf(Item("a", JsonPrimitive(1))))
+        assertEquals(setOf(
+                Triple(listOf("values"), JsonPrimitive("a"), JsonPrimitive(1)),
+                Triple(listOf("ids"), JsonPrimitive("a"), JsonPrimitive(true))
+        ), observer.takeEntries())
+    }
+
+    @Test
+    fun update() {
+        val observer = Observer()
+        observer.upsert(listOf(Item("a", JsonPrimitive(1), 1)))
+        observer.takeEntries()
+
+        observer.upsert(listOf(Item("a", JsonPrimitive(1), 1)))
+        assertEquals(emptySet(), observer.takeEntries())
+
+        observer.upsert(listOf(Item("a", JsonPrimitive(2), 1)))
+        assertTrue(Triple(listOf("values"), JsonPrimitive("a"), JsonPrimitive(2)) in observer.takeEntries())
+
+        observer.upsert(listOf(Item("a", JsonPrimitive(2), 2)))
+        assertTrue(Triple(listOf("refs"), JsonPrimitive("a"), JsonPrimitive("2")) in observer.takeEntries())
+    }
+
+    @Test
+    fun updateEqualValues() {
+        val observer = Observer()
+        val value1 = buildJsonObject {
+            put("x", 1)
+            put("y", 2)
+        }
+        val value2 = buildJsonObject {
+            put("y", 2)
+            put("x", 1)
+        }
+        observer.upsert(listOf(Item("a", value1)))
+        observer.takeEntries()
+
+        // Equal objects with a different order of the members
+        observer.upsert(listOf(Item("a", value2)))
+        assertEquals(emptySet(), observer.takeEntries())
+
+        // References with the same hash code, but a different type
+        observer.upsert(listOf(Item("a", value2, 1)))
+        observer.takeEntries()
+        observer.upsert(listOf(Item("a", value2, 1L)))
+        assertTrue(Triple(listOf("refs"), JsonPrimitive("a"), JsonPrimitive("1")) in observer.takeEntries())
+    }
+
+    @Test
+    fun delete() {
+        val observer = Observer()
+        observer.upsert(listOf(Item("a", JsonPrimitive(1))))
+        observer.takeEntries()
+
+        observer.delete(listOf(Item("a", JsonPrimitive(1)), Item("b", JsonPrimitive(1))))
+        assertEquals(setOf(
+                Triple(listOf("ids"), JsonPrimitive("a"), JsonPrimitive(false))
+        ), observer.takeEntries())
+
+        observer.delete(listOf(Item("a", JsonPrimitive(1))))
+        assertEquals(emptySet(), observer.takeEntries())
+    }
+
+    @Test
+    fun initItems() {
+        val observer = Observer()
+        observer.initItems(listOf(Item("a", JsonPrimitive(1))))
+        assertEquals(emptySet(), observer.takeEntries())
+
+        observer.upsert(listOf(Item("a", JsonPrimitive(1)), Item("b", JsonPrimitive(1))))
+        assertEquals(setOf(
+                Triple(listOf("values"), JsonPrimitive("b"), JsonPrimitive(1)),
+                Triple(listOf("ids"), JsonPrimitive("b"), JsonPrimitive(true))
+        ), observer.takeEntries())
+    }
+}
@@ -0,0 +1,73 @@
+package org.decsync.library
+
+import kotlinx.serialization.json.*
+import kotlin.test.*
+
+@ExperimentalStdlibApi
+class JsonTextTest {
+    @Test
+    fun canonicalUnchanged() {
+        val texts = listOf(
+                "\"key\"",
+                "\"unicode \u263A \uD83C\uDF08\"",
+                "\"escapes \\\" \\\\ \\n \\t \\u0001\"",
+                "0", "-1.5e+10", "true", "false", "null",
+                "[]", "[1,\"a\",[null]]",
+                "{}", "{\"a\":1}", "{\"a\":1,\"b\":{\"c\":[]}}"
+        )
+        for (text in texts) {
+            val jsonText = JsonText.fromText(text)
+            assertEquals(text, jsonText.text)
+            assertEquals(json.parseToJsonElement(text), jsonText.element)
+        }
+    }
+
+    @Test
+    fun nonCanonicalNormalized() {
+        val texts = listOf(
+                " \"key\"",
+                "[1, 2]",
+                "{ \"a\" : 1 }",
+                "\"\\u0041\"",
+                "\"\\/\"",
+                "\"\\u000a\""
+        )
+        for (text in texts) {
+            val element = json.parseToJsonElement(text)
+            assertEquals(element.toString(), JsonText.fromText(text).text)
+        }
+    }
+
+    @Test
+    fun invalidFails() {
+        assertFails { JsonText.fromText("[1,") }
+        assertFails { JsonText.fromText("\"unterminated") }
+    }
+
+    @Test
+    fun equality() {
+        assertEquals(JsonText(JsonPrimitive("key")), JsonText.fromText("\"key\""))
+        assertEquals(JsonText(JsonPrimitive("key")).hashCode(), JsonText.fromText("\"key\"").hashCode())
+        assertNotEquals(JsonText.fromText("1"), JsonText.fromText("1.0"))
+        // The order of the members of an object is not relevant
+        assertEquals(JsonText.fromText("{\"a\":1,\"b\":2}"), JsonText.fromText("{\"b\":2,\"a\":1}"))
+    }
+
+    @Test
+    fun splitArray() {
+        val items = JsonText.splitArray("[\"2020-08-23T00:00:00\",\"key\",{\"a\":[1,2]}]")!!
+        assertEquals(listOf("\"2020-08-23T00:00:00\"", "\"key\"", "{\"a\":[1,2]}"), items.map { it.text })
+        assertEquals("2020-08-23T00:00:00", items[0].stringContent())
+        assertNull(items[2].stringContent())
+        assertNull(JsonText.splitArray("[\"a\", \"b\"]"))
+        assertNull(JsonText.splitArray("[\"a\"]x"))
+    }
+
+    @Test
+    fun entryLine() {
+        val line = "[\"2020-08-23T00:00:00\",\"key\",\"value \u263A\"]"
+        val entry = Decsync.Entry.fromLine(line)!!
+        assertEquals(line, entry.toLine())
+        assertEquals(Decsync.Entry("2020-08-23T00:00:00", JsonPrimitive("key"), JsonPrimitive("value \u263A")), entry)
+    }
+}
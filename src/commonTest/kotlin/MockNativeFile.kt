@@ -11,7 +11,8 @@ class MockRealFile(
         parent.children.remove(this)
     }
     override fun length(): Int = content.size
-    override fun read(readBytes: Int): ByteArray = content.copyOfRange(readBytes, content.size)
+    override fun read(readBytes: Int, maxLength: Int): ByteArray =
+            content.copyOfRange(readBytes, readBytes + minOf(maxLength, content.size - readBytes))
     override fun write(text: ByteArray, append: Boolean) {
         if (append) {
             content += text
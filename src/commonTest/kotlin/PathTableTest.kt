@@ -0,0 +1,24 @@
+package org.decsync.library
+
+import kotlin.test.*
+
+class PathTableTest {
+    @Test
+    fun internIdentical() {
+        val path = PathTable.intern(listOf("articles", "read", "2020", "08", "23"))
+        assertSame(path, PathTable.intern(listOf("articles", "read", "2020", "08", "23")))
+        assertSame(path, PathTable.intern(path))
+        assertNotSame(path, PathTable.intern(listOf("articles", "marked", "2020", "08", "23")))
+    }
+
+    @Test
+    fun equalToList() {
+        val list = listOf("feeds", "names")
+        val path = PathTable.intern(list)
+        assertEquals(list, path)
+        assertEquals(path, list)
+        assertEquals(list.hashCode(), path.hashCode())
+        assertNotEquals(PathTable.intern(listOf("feeds")), path)
+        assertEquals(mapOf(list to 1), mapOf(path to 1))
+    }
+}
@@ -21,4 +21,5 @@ package org.decsync.library
 import platform.posix.*
 
 actual fun Int.off_t(): off_t = this.toLong()
-actual fun Int.size_t(): size_t = this.toULong()
\ No newline at end of file
+actual fun Int.size_t(): size_t = this.toULong()
+actual fun Int.nfds_t(): nfds_t = this.toULong()
@@ -0,0 +1,204 @@
+/**
+ * decsync-tool - inspection and maintenance of DecSync directories
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libdecsync.h>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* usage =
+	"Usage: decsync-tool COMMAND [OPTION]... SYNC_TYPE [COLLECTION]\n"
+	"\n"
+	"Commands:\n"
+	"  stats    sizes, entry counts and dead entries per app and path\n"
+	"  verify   check for unparsable lines, empty files and read offsets past the end of a file\n"
+	"  compact  remove the dead entries from the new-entries files\n"
+	"  prune    delete the data of apps which have not been active for a while\n"
+	"  lag      number of unread bytes per app and peer\n"
+	"\n"
+	"Options:\n"
+	"  -d, --dir DIR      DecSync directory, instead of the default one\n"
+	"  -j, --threads N    number of threads used for the scans, instead of the number of CPUs\n"
+	"  --app APP_ID       compact only the entries written by APP_ID\n"
+	"  --before DATE      prune the apps last active before DATE, of the form yyyy-MM-dd\n"
+	"  --days N           prune the apps last active more than N days ago\n"
+	"\n"
+	"compact and prune also modify the files of other apps, so only use them while no app is\n"
+	"syncing the collection.\n";
+
+struct Options {
+	std::string command;
+	std::string dir;
+	std::string sync_type;
+	std::string collection;
+	std::string app_id;
+	std::string before;
+	int threads = 0;
+};
+
+struct AppStats {
+	long long bytes = 0;
+	long long entries = 0;
+	long long dead_entries = 0;
+};
+
+typedef std::map<std::pair<std::string, std::string>, AppStats> StatsPerApp;
+
+double dead_ratio(long long entries, long long dead_entries) {
+	return entries == 0 ? 0.0 : 100.0 * dead_entries / entries;
+}
+
+void on_stats(const char* kind, const char* app_id, const char** path, int len, int bytes, int entries, int dead_entries, void* extra) {
+	std::string path_string;
+	for (int i = 0; i < len; ++i) {
+		path_string += "/";
+		path_string += path[i];
+	}
+	std::cout << kind << '\t' << app_id << '\t' << path_string << '\t' << bytes << '\t' << entries << '\t'
+		<< dead_entries << '\t' << dead_ratio(entries, dead_entries) << "%\n";
+
+	AppStats& app_stats = (*static_cast<StatsPerApp*>(extra))[{kind, app_id}];
+	app_stats.bytes += bytes;
+	app_stats.entries += entries;
+	app_stats.dead_entries += dead_entries;
+}
+
+void on_problem(const char* file, int line, const char* message, void*) {
+	std::cout << file;
+	if (line > 0) {
+		std::cout << ':' << line;
+	}
+	std::cout << ": " << message << '\n';
+}
+
+void on_lag(const char* app_id, const char* peer_app_id, long long unread_bytes, void*) {
+	std::cout << app_id << '\t' << peer_app_id << '\t' << unread_bytes << '\n';
+}
+
+void on_pruned(const char* app_id, void*) {
+	std::cout << "Pruned " << app_id << '\n';
+}
+
+// Returns the UTC date of [days] days ago, in the format of the last-active info
+std::string date_days_ago(long days) {
+	std::time_t time = std::time(nullptr) - days * 24 * 60 * 60;
+	std::tm tm;
+	gmtime_r(&time, &tm);
+	char date[16];
+	std::strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+	return date;
+}
+
+bool parse_args(int argc, char** argv, Options& options) {
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if ((arg == "-d" || arg == "--dir") && has_value) {
+			options.dir = argv[++i];
+		} else if ((arg == "-j" || arg == "--threads") && has_value) {
+			options.threads = std::atoi(argv[++i]);
+			if (options.threads <= 0) return false;
+		} else if (arg == "--app" && has_value) {
+			options.app_id = argv[++i];
+		} else if (arg == "--before" && has_value) {
+			options.before = argv[++i];
+		} else if (arg == "--days" && has_value) {
+			long days = std::atol(argv[++i]);
+			if (days <= 0) return false;
+			options.before = date_days_ago(days);
+		} else if (!arg.empty() && arg[0] == '-') {
+			return false;
+		} else {
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() < 2 || positional.size() > 3) return false;
+	options.command = positional[0];
+	options.sync_type = positional[1];
+	if (positional.size() == 3) {
+		options.collection = positional[2];
+	}
+	if (options.threads == 0) {
+		options.threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	return true;
+}
+
+int run(const Options& options) {
+	const char* dir = options.dir.c_str();
+	const char* sync_type = options.sync_type.c_str();
+	const char* collection = options.collection.c_str();
+	int threads = options.threads;
+
+	if (options.command == "stats") {
+		StatsPerApp stats_per_app;
+		std::cout << "kind\tapp\tpath\tbytes\tentries\tdead\tdead ratio\n";
+		decsync_maintenance_stats(dir, sync_type, collection, threads, on_stats, &stats_per_app);
+		std::cout << "\nkind\tapp\tbytes\tentries\tdead\tdead ratio\n";
+		for (const auto& [key, app_stats] : stats_per_app) {
+			std::cout << key.first << '\t' << key.second << '\t' << app_stats.bytes << '\t' << app_stats.entries << '\t'
+				<< app_stats.dead_entries << '\t' << dead_ratio(app_stats.entries, app_stats.dead_entries) << "%\n";
+		}
+		return 0;
+	} else if (options.command == "verify") {
+		int problems = decsync_maintenance_verify(dir, sync_type, collection, threads, on_problem, nullptr);
+		std::cout << problems << " problem(s) found\n";
+		return problems == 0 ? 0 : 1;
+	} else if (options.command == "compact") {
+		int removed = decsync_maintenance_compact(dir, sync_type, collection, options.app_id.c_str(), threads);
+		if (removed < 0) {
+			std::cerr << "Compaction failed\n";
+			return 1;
+		}
+		std::cout << "Removed " << removed << " dead entries\n";
+		return 0;
+	} else if (options.command == "prune") {
+		if (options.before.empty()) {
+			std::cerr << "prune requires --before or --days\n";
+			return 2;
+		}
+		int pruned = decsync_maintenance_prune(dir, sync_type, collection, options.before.c_str(), on_pruned, nullptr);
+		std::cout << "Pruned " << pruned << " app(s)\n";
+		return 0;
+	} else if (options.command == "lag") {
+		std::cout << "app\tpeer\tunread bytes\n";
+		decsync_maintenance_lag(dir, sync_type, collection, threads, on_lag, nullptr);
+		return 0;
+	}
+	std::cerr << usage;
+	return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!parse_args(argc, argv, options)) {
+		std::cerr << usage;
+		return 2;
+	}
+	return run(options);
+}
@@ -0,0 +1,46 @@
+/**
+ * libdecsync - DirectoryLock.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import platform.posix.*
+import kotlin.system.getTimeMillis
+
+internal actual class DirectoryLock(private val fd: Int) {
+    actual fun release() {
+        flock(fd, LOCK_UN)
+        close(fd)
+    }
+}
+
+internal actual fun lockDirectory(path: String, timeoutMillis: Int): DirectoryLock? {
+    mkdirs(path)
+    val fd = open(path, O_RDONLY or O_DIRECTORY or O_CLOEXEC)
+    if (fd < 0) throw Exception("Failed to open directory $path")
+    val deadline = getTimeMillis() + timeoutMillis
+    while (flock(fd, LOCK_EX or LOCK_NB) != 0) {
+        if (errno == EINTR) continue
+        if (errno != EWOULDBLOCK || (timeoutMillis >= 0 && getTimeMillis() >= deadline)) {
+            close(fd)
+            return null
+        }
+        usleep((LOCK_RETRY_MILLIS * 1000).toUInt())
+    }
+    return DirectoryLock(fd)
+}
@@ -0,0 +1,194 @@
+/**
+ * libdecsync - DirectoryWatcher.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+import platform.linux.*
+import platform.posix.*
+import kotlin.native.concurrent.AtomicReference
+import kotlin.native.concurrent.Worker
+import kotlin.system.getTimeMillis
+
+// Wait until no changes are made for this duration before signaling
+private const val QUIET_MILLIS = 250L
+// But never delay a signal longer than this duration
+private const val MAX_DELAY_MILLIS = 2000L
+private const val BUFFER_SIZE = 4096
+
+/**
+ * Uses inotify on a separate worker thread. As inotify does not watch subdirectories, a watch is
+ * added for every (new) subdirectory. The directory is created if it does not exist yet, as it
+ * cannot be watched otherwise. When events are lost by an overflow of the inotify queue, or the
+ * directory is removed, the watches are added again and a change is signaled.
+ */
+internal actual class DirectoryWatcher actual constructor(
+        private val dir: String,
+        private val excludedName: String
+) {
+    private val signal = EventSignal()
+    private val stop = EventSignal()
+    private val inotifyFd = inotify_init1(IN_NONBLOCK or IN_CLOEXEC)
+    // Only used on the worker after initialization
+    private val paths = mutableMapOf<Int, String>()
+    private val worker = Worker.start(name = "decsync-notify")
+    // Add the watches directly, such that no changes after the construction are missed
+    private val isWatching = inotifyFd >= 0 && addWatches(dir, true)
+    // Without the watches the signal would never become readable, so no descriptor is given out
+    actual val fd: Int get() = if (isWatching) signal.fd else -1
+    private val mOnChange = AtomicReference<(() -> Unit)?>(null)
+    actual var onChange: (() -> Unit)?
+        get() = mOnChange.value
+        set(value) {
+            mOnChange.value = value
+        }
+
+    init {
+        if (isWatching) {
+            worker.executeAfter(0L) { watch() }
+        } else {
+            Log.e("Failed to watch $dir")
+        }
+    }
+
+    actual fun reset() {
+        signal.reset()
+    }
+
+    actual fun dispose() {
+        stop.signal()
+        worker.requestTermination().result
+        if (inotifyFd >= 0) {
+            close(inotifyFd)
+        }
+        signal.dispose()
+        stop.dispose()
+    }
+
+    private fun watch() {
+        val buffer = nativeHeap.allocArray<ByteVar>(BUFFER_SIZE)
+        val fds = nativeHeap.allocArray<pollfd>(2)
+        fds[0].fd = inotifyFd
+        fds[0].events = POLLIN.toShort()
+        fds[1].fd = stop.fd
+        fds[1].events = POLLIN.toShort()
+        try {
+            var firstChange = -1L
+            var lastChange = -1L
+            while (true) {
+                val timeout = if (firstChange < 0) -1 else {
+                    val deadline = minOf(lastChange + QUIET_MILLIS, firstChange + MAX_DELAY_MILLIS)
+                    (deadline - getTimeMillis()).coerceAtLeast(0L).toInt()
+                }
+                if (poll(fds, 2.nfds_t(), timeout) < 0 && errno != EINTR) {
+                    Log.e("Failed to poll inotify for $dir")
+                    break
+                }
+                if (fds[1].revents.toInt() != 0) break
+                if (fds[0].revents.toInt() and POLLIN != 0 && readEvents(buffer)) {
+                    lastChange = getTimeMillis()
+                    if (firstChange < 0) {
+                        firstChange = lastChange
+                    }
+                }
+                if (firstChange >= 0) {
+                    val now = getTimeMillis()
+                    if (now >= lastChange + QUIET_MILLIS || now >= firstChange + MAX_DELAY_MILLIS) {
+                        signal.signal()
+                        onChange?.invoke()
+                        firstChange = -1L
+                    }
+                }
+            }
+        } finally {
+            nativeHeap.free(fds)
+            nativeHeap.free(buffer)
+        }
+    }
+
+    // Returns whether a change is read
+    private fun readEvents(buffer: CArrayPointer<ByteVar>): Boolean {
+        var changed = false
+        while (true) {
+            val len = read(inotifyFd, buffer, BUFFER_SIZE.size_t()).toInt()
+            if (len <= 0) return changed
+            var offset = 0
+            while (offset < len) {
+                val event = (buffer + offset)!!.reinterpret<inotify_event>().pointed
+                val name = if (event.len == 0u) "" else (buffer + offset + sizeOf<inotify_event>().toInt())!!.toKString()
+                offset += sizeOf<inotify_event>().toInt() + event.len.toInt()
+                val mask = event.mask.toInt()
+                if (mask and IN_Q_OVERFLOW != 0) {
+                    // Events are lost, including the creation of directories
+                    addWatches(dir, true)
+                    changed = true
+                    continue
+                }
+                if (mask and IN_IGNORED != 0) {
+                    if (paths.remove(event.wd) == dir) {
+                        // The directory itself is removed
+                        addWatches(dir, true)
+                        changed = true
+                    }
+                    continue
+                }
+                val parent = paths[event.wd] ?: continue
+                // Changes of our own app are not relevant
+                if (parent == dir && name == excludedName) continue
+                if (mask and IN_ISDIR != 0 && mask and (IN_CREATE or IN_MOVED_TO) != 0) {
+                    // Files may already be written before the watch is added
+                    addWatches("$parent/$name", false)
+                }
+                changed = true
+            }
+        }
+    }
+
+    // Returns whether the watch of [path] is added
+    private fun addWatches(path: String, isRoot: Boolean): Boolean {
+        if (isRoot) {
+            mkdirs(path)
+        }
+        val mask = IN_CREATE or IN_CLOSE_WRITE or IN_MOVED_TO or IN_DELETE or IN_ONLYDIR
+        val wd = inotify_add_watch(inotifyFd, path, mask.toUInt())
+        if (wd < 0) return false
+        paths[wd] = path
+        val dirp = opendir(path) ?: return true
+        try {
+            while (true) {
+                val entry = readdir(dirp)?.pointed ?: break
+                val name = entry.d_name.toKString()
+                if (name == "." || name == ".." || (isRoot && name == excludedName)) continue
+                val type = entry.d_type.toInt()
+                // Some file systems do not report the type
+                if (type == DT_DIR || (type == DT_UNKNOWN && isDirectory("$path/$name"))) {
+                    addWatches("$path/$name", false)
+                }
+            }
+        } finally {
+            closedir(dirp)
+        }
+        return true
+    }
+
+    private fun isDirectory(path: String): Boolean = memScoped {
+        val fileStat = alloc<stat>()
+        stat(path, fileStat.ptr) == 0 && fileStat.st_mode.toInt() and S_IFMT == S_IFDIR
+    }
+}
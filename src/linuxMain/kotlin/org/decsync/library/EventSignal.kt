@@ -0,0 +1,50 @@
+/**
+ * libdecsync - EventSignal.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+import platform.linux.EFD_CLOEXEC
+import platform.linux.EFD_NONBLOCK
+import platform.linux.eventfd
+import platform.posix.close
+import platform.posix.read
+import platform.posix.write
+
+internal actual class EventSignal actual constructor() {
+    actual val fd: Int = eventfd(0u, EFD_NONBLOCK or EFD_CLOEXEC)
+
+    actual fun signal() {
+        memScoped {
+            val value = alloc<ULongVar>()
+            value.value = 1u
+            write(fd, value.ptr, 8.size_t())
+        }
+    }
+
+    actual fun reset() {
+        memScoped {
+            val value = alloc<ULongVar>()
+            read(fd, value.ptr, 8.size_t())
+        }
+    }
+
+    actual fun dispose() {
+        close(fd)
+    }
+}
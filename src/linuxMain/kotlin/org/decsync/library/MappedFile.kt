@@ -0,0 +1,40 @@
+/**
+ * libdecsync - MappedFile.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+import platform.posix.*
+
+internal actual fun mapFile(path: String): MappedFile? {
+    val fd = open(path, O_RDONLY or O_CLOEXEC)
+    if (fd < 0) return null
+    val size = memScoped {
+        val fileStat = alloc<stat>()
+        fstat(fd, fileStat.ptr)
+        fileStat.st_size.toInt()
+    }
+    val data = if (size > 0) mmap(null, size.size_t(), PROT_READ, MAP_PRIVATE, fd, 0) else null
+    // The mapping stays valid after closing the file
+    close(fd)
+    if (data == null || data == MAP_FAILED) return null
+    return MappedFile(data.reinterpret(), size) {
+        munmap(data, size.size_t())
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * libdecsync - ReadWriteLock.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+import platform.posix.*
+
+internal actual class ReadWriteLock actual constructor() {
+    private val lock = nativeHeap.alloc<pthread_rwlock_t>().also {
+        pthread_rwlock_init(it.ptr, null)
+    }
+
+    actual fun <R> read(action: () -> R): R {
+        pthread_rwlock_rdlock(lock.ptr)
+        try {
+            return action()
+        } finally {
+            pthread_rwlock_unlock(lock.ptr)
+        }
+    }
+
+    actual fun <R> write(action: () -> R): R {
+        pthread_rwlock_wrlock(lock.ptr)
+        try {
+            return action()
+        } finally {
+            pthread_rwlock_unlock(lock.ptr)
+        }
+    }
+
+    actual fun dispose() {
+        pthread_rwlock_destroy(lock.ptr)
+        nativeHeap.free(lock)
+    }
+}
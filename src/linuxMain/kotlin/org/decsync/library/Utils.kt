@@ -22,6 +22,7 @@ import kotlinx.cinterop.*
 import platform.posix.*
 
 expect fun Int.size_t(): size_t
+expect fun Int.nfds_t(): nfds_t
 
 actual val openFlagsBinary = 0
 actual fun mkdirCustom(path: String, mode: Int) {
@@ -34,6 +35,15 @@ actual fun writeCustom(fd: Int, buf: CValuesRef<*>?, size: Int) {
     write(fd, buf, size.size_t())
 }
 actual fun gethostnameCustom(name: CValuesRef<ByteVar>, size: Int): Int = gethostname(name, size.size_t())
+internal actual fun fileStatCustom(path: String): FileStat? = memScoped {
+    val fileStat = alloc<stat>()
+    if (stat(path, fileStat.ptr) != 0) {
+        null
+    } else {
+        FileStat(fileStat.st_mtim.tv_sec.toLong() * 1_000_000_000L + fileStat.st_mtim.tv_nsec.toLong(), fileStat.st_size.toLong())
+    }
+}
+actual fun gmtimeCustom(time: CValuesRef<time_tVar>, result: CValuesRef<tm>): Boolean = gmtime_r(time, result) != null
 
 actual fun getDefaultDecsyncDir(): String =
         getenv("DECSYNC_DIR")?.toKString() ?: getUserDataDir() + "/decsync"
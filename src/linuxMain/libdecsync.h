@@ -11,6 +11,7 @@ typedef void* Decsync;
 typedef void* DecsyncEntryWithPath;
 typedef void* DecsyncEntry;
 typedef void* DecsyncStoredEntry;
+typedef void* DecsyncCursor;
 
 /**
  * The `DecSync` class represents an interface to synchronized key-value mappings stored on the file
@@ -61,21 +62,60 @@ typedef void* DecsyncStoredEntry;
  * reinstalled, it may reuse its old appId. In that case, it has to call
  * [decsync_init_stored_entries] and [decsync_execute_stored_entry] or similar. Even if the old
  * appId is not reused, it is still recommended to call these. For the default appId, use
- * [decsync_get_app_id] or [decsync_get_app_id_with_id].
+ * [decsync_get_app_id] or [decsync_get_app_id_with_id]. To enforce this, use
+ * [decsync_new_with_lock].
  * @return an error code indicating success or failure:
  *   - 0 for success
  *   - 1 for invalid info
  *   - 2 for unsupported version
+ *   - 4 for another error, like a directory which cannot be accessed
  */
 inline static int decsync_new(Decsync* decsync, const char* decsync_dir, const char* sync_type, const char* collection, const char* own_app_id) {
     return decsync_so_new(decsync, decsync_dir, sync_type, collection, own_app_id);
 }
 
 /**
- * Marks the [decsync] instance as finalized. This function has to be called after adding all the
- * listeners, otherwise the [decsync] instance cannot be used from other threads. However, this call
- * only makes it possible to use the instance from other threads, but does not make it safe to have
- * such concurrent calls. For this, it is still necessary to use a mutex for example.
+ * Like [decsync_new], but also enforces that there are no two simultaneous instances with the same
+ * appId. It takes an advisory lock on the local directory of [own_app_id], also across processes,
+ * which is held until [decsync_free] is called.
+ *
+ * @param timeout_ms how long to wait in milliseconds when the appId is in use by another instance.
+ *   Use 0 to fail directly and a negative value to wait indefinitely.
+ * @return an error code indicating success or failure:
+ *   - 0 for success
+ *   - 1 for invalid info
+ *   - 2 for unsupported version
+ *   - 3 for an appId in use by another instance
+ *   - 4 for another error, like a local directory which cannot be opened for locking
+ */
+inline static int decsync_new_with_lock(Decsync* decsync, const char* decsync_dir, const char* sync_type, const char* collection, const char* own_app_id, int timeout_ms) {
+    return decsync_so_new_with_lock(decsync, decsync_dir, sync_type, collection, own_app_id, timeout_ms);
+}
+
+/**
+ * Enables a persistent cache of the directory listings, stored in the file `local/.decsync-cache`
+ * of the collection. It is useful when many short-lived processes use the same DecSync directory:
+ * a new process reuses the listings of the directories whose modification time is unchanged,
+ * instead of reading the whole directory tree again. The cache also keeps the keys in every read
+ * file, so a lookup of specific keys skips the files whose size and modification time show that
+ * they do not contain them. The cache file is memory-mapped and it is updated atomically by
+ * [decsync_free], so it can be shared between processes.
+ *
+ * @param decsync the [Decsync] instance to use.
+ */
+inline static void decsync_enable_directory_cache(Decsync decsync) {
+    decsync_so_enable_directory_cache(decsync);
+}
+
+/**
+ * Deprecated. A [Decsync] instance can always be used from multiple threads and this function does
+ * nothing anymore.
+ *
+ * Concurrent calls on the same instance are synchronized internally. Calls which write entries
+ * (like [decsync_set_entry] and [decsync_execute_all_new_entries]) are executed one at a time,
+ * while calls which only read the stored entries (like [decsync_execute_stored_entries] and
+ * [decsync_latest_app_id]) can run in parallel. Listeners may therefore be called from multiple
+ * threads at the same time.
  *
  * @param decsync the [Decsync] instance to use.
  */
@@ -84,7 +124,10 @@ inline static void decsync_init_done(Decsync decsync) {
 }
 
 /**
- * Frees an existing [Decsync] instance.
+ * Frees an existing [Decsync] instance. Waits for the step of an asynchronous call which is being
+ * executed. The asynchronous calls which are not completed yet are cancelled: their completion
+ * functions are called on the current thread. It must not be called from a listener or a
+ * completion function of the same instance, which aborts with an error.
  */
 inline static void decsync_free(Decsync decsync) {
     decsync_so_free(decsync);
@@ -238,6 +281,58 @@ inline static void decsync_execute_all_new_entries(Decsync decsync, void* extra)
     decsync_so_execute_all_new_entries(decsync, extra);
 }
 
+/**
+ * Returns a file descriptor which becomes readable when other apps write new entries, such that
+ * [decsync_execute_all_new_entries] only has to be called when there is something to read. It can
+ * be added to a poll/epoll based event loop instead of polling at a fixed interval.
+ *
+ * Changes are debounced, so a burst of writes (e.g. by a file synchronizer) results in a single
+ * wakeup. The descriptor stays readable until [decsync_execute_all_new_entries] is called; it must
+ * not be read or closed by the caller. The directory is watched from the first call on. Not
+ * supported on Windows, where -1 is returned. -1 is also returned when the directory cannot be
+ * watched, e.g. when inotify is unavailable, in which case the caller has to poll instead.
+ *
+ * @param decsync the [Decsync] instance to use.
+ */
+inline static int decsync_get_notify_fd(Decsync decsync) {
+    return decsync_so_get_notify_fd(decsync);
+}
+
+/**
+ * Starts executing the new entries automatically in the background, instead of calling
+ * [decsync_execute_all_new_entries] periodically. The maintenance work of
+ * [decsync_execute_all_new_entries] is included.
+ *
+ * New entries are executed shortly after other apps write them, using the same debounced change
+ * detection as [decsync_get_notify_fd]. Additionally, the directory is polled, which is the only
+ * detection on Windows. The polling interval starts at [min_interval_ms] and doubles every time
+ * nothing has changed, up to [max_interval_ms], such that an idle instance hardly wakes up.
+ *
+ * The calls are executed on the worker thread of the asynchronous calls, so the listeners are
+ * called on the thread chosen by [decsync_set_async_on_caller_thread]. Calling this function again
+ * replaces the previous settings.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param extra extra userdata passed to the [listeners].
+ * @param min_interval_ms the minimal polling interval in milliseconds. Values below 1 are
+ * replaced by 1.
+ * @param max_interval_ms the maximal polling interval in milliseconds. Values below
+ * [min_interval_ms] are replaced by [min_interval_ms].
+ */
+inline static void decsync_start_auto_sync(Decsync decsync, void* extra, int min_interval_ms, int max_interval_ms) {
+    decsync_so_start_auto_sync(decsync, extra, min_interval_ms, max_interval_ms);
+}
+
+/**
+ * Stops the automatic execution of [decsync_start_auto_sync]. An execution which is already running
+ * is completed.
+ *
+ * @param decsync the [Decsync] instance to use.
+ */
+inline static void decsync_stop_auto_sync(Decsync decsync) {
+    decsync_so_stop_auto_sync(decsync);
+}
+
 /**
  * Gets the stored entry in [path] with key [key] and executes the corresponding action, passing
  * extra data [extra] to the listener.
@@ -350,6 +445,81 @@ inline static void decsync_execute_all_stored_entries_for_path(Decsync decsync,
     decsync_so_execute_all_stored_entries_for_path(decsync, path, len, extra);
 }
 
+/**
+ * Calls [on_change] for every entry which is stored after [watermark], both the entries written by
+ * this app and the ones executed from other apps. Only the latest entry of every path and key is
+ * passed, in the order of storing. The changes are read from a local journal which is appended when
+ * entries are stored, so no stored entries are scanned. No listeners are called.
+ *
+ * The journal is only kept once the app takes its first [decsync_current_changes_watermark] and
+ * only contains the entries stored since, so a new consumer takes the
+ * [decsync_current_changes_watermark] and then executes all stored entries once. The same
+ * holds when -1 is returned: the journal was removed or started again, so the changes since
+ * [watermark] are unknown. In that case, take a new [decsync_current_changes_watermark] and
+ * execute all stored entries again.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param watermark the watermark returned by a previous call or by
+ * [decsync_current_changes_watermark].
+ * @param on_change function called for every changed entry, with the full path of the entry.
+ * @param extra extra userdata passed to [on_change].
+ * @return the new watermark, or -1 if [watermark] is stale.
+ */
+inline static long long decsync_changes_since(Decsync decsync, long long watermark, void (*on_change)(const char** path, int len, const char* datetime, const char* key, const char* value, void* extra), void* extra) {
+    return decsync_so_changes_since(decsync, watermark, (void*)on_change, extra);
+}
+
+/**
+ * Returns the watermark of the end of the change journal. The first call starts the journal. See
+ * [decsync_changes_since].
+ *
+ * @param decsync the [Decsync] instance to use.
+ */
+inline static long long decsync_current_changes_watermark(Decsync decsync) {
+    return decsync_so_current_changes_watermark(decsync);
+}
+
+/**
+ * Opens a cursor over the stored entries of all paths starting with [prefix]. Unlike the execute
+ * functions, no listeners are called: the entries are pulled one by one with [decsync_cursor_next]
+ * in path order. The stored entries are read one file at a time, so reading can be stopped at any
+ * point without reading the remaining files. The cursor has to be closed with
+ * [decsync_cursor_close] before the [decsync] instance is freed. A cursor must only be used by one
+ * thread at a time, but other calls on the instance can be made in between.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param prefix path prefix of null-terminated strings to the entries to return.
+ * @param len length of [prefix].
+ */
+inline static DecsyncCursor decsync_cursor_open(Decsync decsync, const char** prefix, int len) {
+    return decsync_so_cursor_open(decsync, prefix, len);
+}
+
+/**
+ * Moves the [cursor] to the next stored entry. The returned strings are valid until the next call
+ * to [decsync_cursor_next] or [decsync_cursor_close].
+ *
+ * @param cursor the [DecsyncCursor] to use.
+ * @param path set to the path of the entry, as array of null-terminated strings.
+ * @param len set to the length of [path].
+ * @param datetime set to the datetime of the entry.
+ * @param key set to the key of the entry, as JSON-serialized string.
+ * @param value set to the value of the entry, as JSON-serialized string.
+ * @return true if an entry is returned, false if all entries are read.
+ */
+inline static bool decsync_cursor_next(DecsyncCursor cursor, const char*** path, int* len, const char** datetime, const char** key, const char** value) {
+    return decsync_so_cursor_next(cursor, path, len, datetime, key, value);
+}
+
+/**
+ * Closes the [cursor] and frees its resources.
+ *
+ * @param cursor the [DecsyncCursor] to close.
+ */
+inline static void decsync_cursor_close(DecsyncCursor cursor) {
+    decsync_so_cursor_close(cursor);
+}
+
 /**
  * Initializes the stored entries. This method does not execute any actions. This is often followed
  * with a call to [decsync_execute_stored_entries].
@@ -373,6 +543,121 @@ inline static void decsync_latest_app_id(Decsync decsync, char* app_id, int len)
     decsync_so_latest_app_id(decsync, app_id, len);
 }
 
+/**
+ * Like [decsync_set_entries], but the entries are written asynchronously on a worker thread owned
+ * by the [decsync] instance. All asynchronous calls of an instance are executed one at a time, in
+ * the order in which they are submitted. The entries may be freed directly after this call.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param entries_with_path entries with path which are inserted.
+ * @param len length of [entries_with_path].
+ * @param on_done optional function called when the call is completed, with [done_extra] as
+ *   argument. It is called on the worker thread, unless [decsync_set_async_on_caller_thread] is
+ *   enabled.
+ * @param done_extra extra userdata passed to [on_done].
+ */
+inline static void decsync_set_entries_async(Decsync decsync, DecsyncEntryWithPath* entries_with_path, int len, void (*on_done)(void* done_extra), void* done_extra) {
+    decsync_so_set_entries_async(decsync, entries_with_path, len, (void*)on_done, done_extra);
+}
+
+/**
+ * Like [decsync_execute_all_new_entries], but executed asynchronously. See
+ * [decsync_set_entries_async]. The entries are read in batches of one file. When
+ * [decsync_set_async_on_caller_thread] is enabled, the listeners of a batch are called by
+ * [decsync_dispatch_async] and the batch is only stored afterwards, so their return values are
+ * respected. Other calls on the instance may run between two batches.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param extra extra userdata passed to the [listeners].
+ * @param on_done optional function called when the call is completed.
+ * @param done_extra extra userdata passed to [on_done].
+ */
+inline static void decsync_execute_all_new_entries_async(Decsync decsync, void* extra, void (*on_done)(void* done_extra), void* done_extra) {
+    decsync_so_execute_all_new_entries_async(decsync, extra, (void*)on_done, done_extra);
+}
+
+/**
+ * Like [decsync_execute_stored_entries], but executed asynchronously. See
+ * [decsync_set_entries_async]. The stored entries may be freed directly after this call. When
+ * [decsync_set_async_on_caller_thread] is enabled, the return values of the listeners are ignored.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param stored_entries entries with path and key to be executed.
+ * @param len length of [stored_entries].
+ * @param extra extra userdata passed to the listener.
+ * @param on_done optional function called when the call is completed.
+ * @param done_extra extra userdata passed to [on_done].
+ */
+inline static void decsync_execute_stored_entries_async(Decsync decsync, DecsyncStoredEntry* stored_entries, int len, void* extra, void (*on_done)(void* done_extra), void* done_extra) {
+    decsync_so_execute_stored_entries_async(decsync, stored_entries, len, extra, (void*)on_done, done_extra);
+}
+
+/**
+ * Like [decsync_execute_all_stored_entries_for_path_prefix], but executed asynchronously. See
+ * [decsync_execute_stored_entries_async].
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param path path prefix of null-terminated strings to the entries to execute.
+ * @param len length of [path].
+ * @param extra extra userdata passed to the listener.
+ * @param on_done optional function called when the call is completed.
+ * @param done_extra extra userdata passed to [on_done].
+ */
+inline static void decsync_execute_all_stored_entries_for_path_prefix_async(Decsync decsync, const char** path, int len, void* extra, void (*on_done)(void* done_extra), void* done_extra) {
+    decsync_so_execute_all_stored_entries_for_path_prefix_async(decsync, path, len, extra, (void*)on_done, done_extra);
+}
+
+/**
+ * Like [decsync_init_stored_entries], but executed asynchronously. See
+ * [decsync_set_entries_async].
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param on_done optional function called when the call is completed.
+ * @param done_extra extra userdata passed to [on_done].
+ */
+inline static void decsync_init_stored_entries_async(Decsync decsync, void (*on_done)(void* done_extra), void* done_extra) {
+    decsync_so_init_stored_entries_async(decsync, (void*)on_done, done_extra);
+}
+
+/**
+ * Sets whether the listeners and completion functions of asynchronous calls are called on the
+ * thread of the caller. When enabled, the reading and writing is still done on the worker thread,
+ * while the listener calls and completion functions are queued in order and only executed by
+ * [decsync_dispatch_async]. The worker does not hold any lock while the calls are queued. Disabled
+ * by default, in which case the listeners and completion functions are called on the worker thread.
+ * The setting applies to the calls submitted afterwards.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @param on_caller_thread whether to queue the listener calls and completion functions.
+ */
+inline static void decsync_set_async_on_caller_thread(Decsync decsync, bool on_caller_thread) {
+    decsync_so_set_async_on_caller_thread(decsync, on_caller_thread);
+}
+
+/**
+ * Returns a file descriptor which becomes readable when an asynchronous call completes or when
+ * calls are queued for [decsync_dispatch_async]. It can be added to a poll/epoll based event loop.
+ * The descriptor is owned by the [decsync] instance and must not be closed. Not supported on
+ * Windows, where -1 is returned.
+ *
+ * @param decsync the [Decsync] instance to use.
+ */
+inline static int decsync_get_async_fd(Decsync decsync) {
+    return decsync_so_get_async_fd(decsync);
+}
+
+/**
+ * Calls the queued listeners and completion functions of asynchronous calls on the current thread
+ * and resets the file descriptor of [decsync_get_async_fd]. The worker continues a call once its
+ * queued listeners are called.
+ *
+ * @param decsync the [Decsync] instance to use.
+ * @return the number of executed batches of listener calls and completion functions.
+ */
+inline static int decsync_dispatch_async(Decsync decsync) {
+    return decsync_so_dispatch_async(decsync);
+}
+
 /**
  * Returns the most up-to-date value stored in the path `["info"]` with key [key], in the given
  * DecSync dir [decsync_dir], sync type [sync_type] and collection [collection]. If no such value is
@@ -403,6 +688,100 @@ inline static int decsync_check_decsync_info(const char* decsync_dir) {
     return decsync_so_check_decsync_info(decsync_dir);
 }
 
+/**
+ * Exports a collection to a single compressed file [archive], which is much faster to copy than the
+ * individual files. An existing file [archive] is replaced. Machine-local caches are left out. An
+ * archive which would exceed 2 GiB is not written.
+ *
+ * @param decsync_dir the path to the main DecSync directory.
+ * @param sync_type the type of data to sync. For example, "contacts" or "calendars".
+ * @param collection collection identifier.
+ * @param archive the path of the archive.
+ * @param app_id if not NULL or empty, only the data of this app and the shared info is exported.
+ * @return 0 for success and -1 if the archive could not be written.
+ */
+inline static int decsync_export_archive(const char* decsync_dir, const char* sync_type, const char* collection, const char* archive, const char* app_id) {
+    return decsync_so_export_archive(decsync_dir, sync_type, collection, archive, app_id);
+}
+
+/**
+ * Restores an [archive] made by [decsync_export_archive] into a collection. Existing files which
+ * are also in the archive are overwritten.
+ *
+ * @param decsync_dir the path to the main DecSync directory.
+ * @param sync_type the type of data to sync. For example, "contacts" or "calendars".
+ * @param collection collection identifier.
+ * @param archive the path of the archive.
+ * @return an error code indicating success or failure:
+ *   - 0 for success
+ *   - 1 for invalid info
+ *   - 2 for unsupported version
+ *   - -1 for an invalid or unreadable archive
+ */
+inline static int decsync_import_archive(const char* decsync_dir, const char* sync_type, const char* collection, const char* archive) {
+    return decsync_so_import_archive(decsync_dir, sync_type, collection, archive);
+}
+
+/**
+ * Calls [on_stats] for every entries file of a collection. The [kind] is "new-entries" or
+ * "stored-entries" and [dead_entries] is the number of entries which are superseded by a more
+ * recent entry with the same key in the same file. The files of the apps are scanned on [threads]
+ * threads.
+ */
+inline static void decsync_maintenance_stats(const char* decsync_dir, const char* sync_type, const char* collection, int threads,
+        void (*on_stats)(const char* kind, const char* app_id, const char** path, int len, int bytes, int entries, int dead_entries, void* extra),
+        void* extra) {
+    decsync_so_maintenance_stats(decsync_dir, sync_type, collection, threads, (void*)on_stats, extra);
+}
+
+/**
+ * Checks a collection for unparsable lines, empty files and read offsets past the end of a file.
+ * [on_problem] is called for every problem, where [line] is the 1-based line number or 0 if it
+ * applies to the whole file. The files of the apps are scanned on [threads] threads.
+ *
+ * @return the number of problems found.
+ */
+inline static int decsync_maintenance_verify(const char* decsync_dir, const char* sync_type, const char* collection, int threads,
+        void (*on_problem)(const char* file, int line, const char* message, void* extra),
+        void* extra) {
+    return decsync_so_maintenance_verify(decsync_dir, sync_type, collection, threads, (void*)on_problem, extra);
+}
+
+/**
+ * Calls [on_lag] with the number of bytes written by [peer_app_id] which are not yet read by
+ * [app_id], for every pair of apps in a collection. The files of the apps are scanned on [threads]
+ * threads.
+ */
+inline static void decsync_maintenance_lag(const char* decsync_dir, const char* sync_type, const char* collection, int threads,
+        void (*on_lag)(const char* app_id, const char* peer_app_id, long long unread_bytes, void* extra),
+        void* extra) {
+    decsync_so_maintenance_lag(decsync_dir, sync_type, collection, threads, (void*)on_lag, extra);
+}
+
+/**
+ * Removes the superseded entries from the new-entries files of a collection, or only from the ones
+ * of [app_id] if it is not NULL or empty. The read offsets of the other apps are adjusted. This
+ * should only be used while no app syncs the collection.
+ *
+ * @return the number of removed lines, or -1 if the compaction failed.
+ */
+inline static int decsync_maintenance_compact(const char* decsync_dir, const char* sync_type, const char* collection, const char* app_id, int threads) {
+    return decsync_so_maintenance_compact(decsync_dir, sync_type, collection, app_id, threads);
+}
+
+/**
+ * Deletes the data of the apps in a collection which were last active before the date [before], of
+ * the form "yyyy-MM-dd". Apps without a known activity are kept. [on_pruned] is called for every
+ * deleted app.
+ *
+ * @return the number of deleted apps.
+ */
+inline static int decsync_maintenance_prune(const char* decsync_dir, const char* sync_type, const char* collection, const char* before,
+        void (*on_pruned)(const char* app_id, void* extra),
+        void* extra) {
+    return decsync_so_maintenance_prune(decsync_dir, sync_type, collection, before, (void*)on_pruned, extra);
+}
+
 /**
  * Deprecated. Use [decsync_list_collections] instead.
  *
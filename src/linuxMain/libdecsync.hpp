@@ -0,0 +1,546 @@
+#ifndef LIBDECSYNC_HPP
+#define LIBDECSYNC_HPP
+
+#include "libdecsync.h"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * C++ wrapper of [libdecsync.h]. Requires C++17 and is header-only.
+ *
+ * An [instance] owns its [Decsync] handle and frees it when it is destroyed. It can be moved, but
+ * not copied. Paths, keys and values are given as [std::string_view]s and are only copied to a
+ * buffer on the stack to add the null terminators, so a call does not allocate on the heap for
+ * common sizes. Entries of [set_entries] and [execute_stored_entries] are collected in a batch,
+ * which keeps its buffers after [clear] to be reused for the next batch.
+ *
+ *     decsync::instance decsync(dir, "rss", std::nullopt, app_id);
+ *     decsync.add_listener({"feeds"}, [](const decsync::entry& entry, void* extra) { ... });
+ *     decsync.set_entry({"feeds", "names"}, "\"https://example.com/feed\"", "\"Feed\"");
+ *     decsync.execute_all_new_entries(&extra);
+ */
+namespace decsync {
+
+/**
+ * Thrown when an instance cannot be created. The [code] is the error code of [decsync_new] or
+ * [decsync_new_with_lock].
+ */
+class error : public std::runtime_error {
+public:
+    explicit error(int code) : std::runtime_error(message(code)), code_(code) {}
+
+    int code() const noexcept { return code_; }
+
+private:
+    int code_;
+
+    static const char* message(int code) {
+        switch (code) {
+            case 1: return "Invalid DecSync info";
+            case 2: return "Unsupported DecSync version";
+            case 3: return "AppId in use by another instance";
+            case 4: return "Failed to access the DecSync directory";
+            default: return "Unknown DecSync error";
+        }
+    }
+};
+
+/**
+ * Non-owning reference to a path, which is a random-access sequence of strings. It can be created
+ * from a braced list of strings or from a container like [std::vector<std::string>]. The referenced
+ * path must outlive the call it is passed to.
+ */
+class path_ref {
+public:
+    path_ref(std::initializer_list<std::string_view> path) noexcept
+            : data_(path.begin()), size_(path.size()), get_(&get_from<const std::string_view*>) {}
+
+    template <typename Container, typename = std::enable_if_t<
+            std::is_convertible_v<decltype(*std::begin(std::declval<const Container&>())), std::string_view>>>
+    path_ref(const Container& path) noexcept
+            : data_(&path), size_(std::size(path)), get_(&get_from_container<Container>) {}
+
+    std::size_t size() const noexcept { return size_; }
+    std::string_view operator[](std::size_t i) const { return get_(data_, i); }
+
+private:
+    const void* data_;
+    std::size_t size_;
+    std::string_view (*get_)(const void*, std::size_t);
+
+    template <typename Pointer>
+    static std::string_view get_from(const void* data, std::size_t i) {
+        return static_cast<Pointer>(data)[i];
+    }
+
+    template <typename Container>
+    static std::string_view get_from_container(const void* data, std::size_t i) {
+        return *std::next(std::begin(*static_cast<const Container*>(data)), i);
+    }
+};
+
+/**
+ * Path of an updated entry, as given to a listener. It is only valid during the call.
+ */
+class path_view {
+public:
+    path_view(const char** data, int size) noexcept : data_(data), size_(size) {}
+
+    std::size_t size() const noexcept { return size_; }
+    std::string_view operator[](std::size_t i) const { return data_[i]; }
+    const char* const* begin() const noexcept { return data_; }
+    const char* const* end() const noexcept { return data_ + size_; }
+
+private:
+    const char** data_;
+    std::size_t size_;
+};
+
+/**
+ * Updated entry given to a listener. The key and value are JSON-serialized. It is only valid
+ * during the call.
+ */
+struct entry {
+    path_view path;
+    std::string_view datetime;
+    std::string_view key;
+    std::string_view value;
+};
+
+/**
+ * Listener of updated entries. The extra data is the one given to the execute functions. Returns
+ * whether the call succeeded, see [decsync_add_listener_with_success].
+ */
+using listener = std::function<bool(const entry&, void* extra)>;
+
+namespace detail {
+
+/**
+ * Null-terminated copies of a path and some further strings. Small arguments are stored on the
+ * stack and only large ones are stored on the heap.
+ */
+class c_args {
+public:
+    c_args(path_ref path, std::initializer_list<std::string_view> strings) : path_len_(path.size()) {
+        std::size_t count = path.size() + strings.size();
+        std::size_t bytes = count;
+        for (std::size_t i = 0; i < path.size(); ++i) {
+            bytes += path[i].size();
+        }
+        for (std::string_view string : strings) {
+            bytes += string.size();
+        }
+        char* chars = bytes <= inline_chars_.size() ? inline_chars_.data() : (heap_chars_.resize(bytes), &heap_chars_[0]);
+        pointers_ = count <= inline_pointers_.size() ? inline_pointers_.data() : (heap_pointers_.resize(count), heap_pointers_.data());
+        std::size_t index = 0;
+        auto add = [&](std::string_view string) {
+            pointers_[index++] = chars;
+            chars = std::copy(string.begin(), string.end(), chars);
+            *chars++ = '\0';
+        };
+        for (std::size_t i = 0; i < path.size(); ++i) {
+            add(path[i]);
+        }
+        for (std::string_view string : strings) {
+            add(string);
+        }
+    }
+
+    c_args(const c_args&) = delete;
+    c_args& operator=(const c_args&) = delete;
+
+    const char** path() noexcept { return pointers_; }
+    int path_len() const noexcept { return static_cast<int>(path_len_); }
+    const char* string(std::size_t i) const noexcept { return pointers_[path_len_ + i]; }
+
+private:
+    std::array<char, 512> inline_chars_;
+    std::array<const char*, 16> inline_pointers_;
+    std::string heap_chars_;
+    std::vector<const char*> heap_pointers_;
+    const char** pointers_;
+    std::size_t path_len_;
+};
+
+/**
+ * Strings of a batch, stored after each other with null terminators in a single buffer.
+ */
+class string_table {
+public:
+    void add(std::string_view string) {
+        offsets_.push_back(chars_.size());
+        chars_.append(string.data(), string.size());
+        chars_ += '\0';
+    }
+
+    // The pointers are invalidated by the next call to [add]
+    const char** pointers() {
+        pointers_.resize(offsets_.size());
+        for (std::size_t i = 0; i < offsets_.size(); ++i) {
+            pointers_[i] = chars_.data() + offsets_[i];
+        }
+        return pointers_.data();
+    }
+
+    void clear() noexcept {
+        chars_.clear();
+        offsets_.clear();
+    }
+
+private:
+    std::string chars_;
+    std::vector<std::size_t> offsets_;
+    std::vector<const char*> pointers_;
+};
+
+}  // namespace detail
+
+/**
+ * Batch of entries with path for [instance::set_entries].
+ */
+class entries_batch {
+public:
+    void add(path_ref path, std::string_view key, std::string_view value) {
+        for (std::size_t i = 0; i < path.size(); ++i) {
+            strings_.add(path[i]);
+        }
+        strings_.add(key);
+        strings_.add(value);
+        path_lens_.push_back(static_cast<int>(path.size()));
+    }
+
+    std::size_t size() const noexcept { return path_lens_.size(); }
+    bool empty() const noexcept { return path_lens_.empty(); }
+
+    /**
+     * Removes all entries, but keeps the allocated buffers.
+     */
+    void clear() noexcept {
+        strings_.clear();
+        path_lens_.clear();
+    }
+
+    /**
+     * Calls [f] with C handles of the entries and their number. The handles are freed afterwards.
+     */
+    template <typename F>
+    void with_handles(F&& f) {
+        const char** strings = strings_.pointers();
+        handles_.clear();
+        for (int path_len : path_lens_) {
+            handles_.push_back(decsync_entry_with_path_new(strings, path_len, strings[path_len], strings[path_len + 1]));
+            strings += path_len + 2;
+        }
+        f(handles_.data(), static_cast<int>(handles_.size()));
+        for (DecsyncEntryWithPath handle : handles_) {
+            decsync_entry_with_path_free(handle);
+        }
+    }
+
+private:
+    detail::string_table strings_;
+    std::vector<int> path_lens_;
+    std::vector<DecsyncEntryWithPath> handles_;
+};
+
+/**
+ * Batch of stored entries for [instance::execute_stored_entries].
+ */
+class stored_entries_batch {
+public:
+    void add(path_ref path, std::string_view key) {
+        for (std::size_t i = 0; i < path.size(); ++i) {
+            strings_.add(path[i]);
+        }
+        strings_.add(key);
+        path_lens_.push_back(static_cast<int>(path.size()));
+    }
+
+    std::size_t size() const noexcept { return path_lens_.size(); }
+    bool empty() const noexcept { return path_lens_.empty(); }
+
+    /**
+     * Removes all stored entries, but keeps the allocated buffers.
+     */
+    void clear() noexcept {
+        strings_.clear();
+        path_lens_.clear();
+    }
+
+    /**
+     * Calls [f] with C handles of the stored entries and their number. The handles are freed
+     * afterwards.
+     */
+    template <typename F>
+    void with_handles(F&& f) {
+        const char** strings = strings_.pointers();
+        handles_.clear();
+        for (int path_len : path_lens_) {
+            handles_.push_back(decsync_stored_entry_new(strings, path_len, strings[path_len]));
+            strings += path_len + 1;
+        }
+        f(handles_.data(), static_cast<int>(handles_.size()));
+        for (DecsyncStoredEntry handle : handles_) {
+            decsync_stored_entry_free(handle);
+        }
+    }
+
+private:
+    detail::string_table strings_;
+    std::vector<int> path_lens_;
+    std::vector<DecsyncStoredEntry> handles_;
+};
+
+/**
+ * Owner of a [DecsyncCursor] handle, opened by [instance::open_cursor]. It has to be destroyed
+ * before its instance.
+ */
+class cursor {
+public:
+    explicit cursor(DecsyncCursor handle) noexcept : handle_(handle) {}
+
+    cursor(cursor&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+    cursor& operator=(cursor&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    cursor(const cursor&) = delete;
+    cursor& operator=(const cursor&) = delete;
+
+    ~cursor() { reset(); }
+
+    /**
+     * Returns the next stored entry with its full path, or nothing if all entries are read. The
+     * entry is valid until the next call, see [decsync_cursor_next].
+     */
+    std::optional<entry> next() {
+        const char** path;
+        int len;
+        const char* datetime;
+        const char* key;
+        const char* value;
+        if (!decsync_cursor_next(handle_, &path, &len, &datetime, &key, &value)) {
+            return std::nullopt;
+        }
+        return entry {path_view(path, len), datetime, key, value};
+    }
+
+private:
+    DecsyncCursor handle_;
+
+    void reset() noexcept {
+        if (handle_) {
+            decsync_cursor_close(std::exchange(handle_, nullptr));
+        }
+    }
+};
+
+/**
+ * Owner of a [Decsync] handle. See [libdecsync.h] for the documentation of the methods.
+ *
+ * The listeners are dispatched by the wrapper itself: a single listener is registered for all
+ * paths and the extra data of the execute functions is wrapped. Therefore, listeners must not be
+ * added directly to the [handle]. Listeners should be added before the instance is used from
+ * multiple threads.
+ */
+class instance {
+public:
+    /**
+     * Creates an instance, see [decsync_new].
+     *
+     * @throws error if the DecSync directory is not supported.
+     */
+    instance(std::string_view decsync_dir, std::string_view sync_type,
+             std::optional<std::string_view> collection, std::string_view own_app_id)
+            : instance(decsync_dir, sync_type, collection, own_app_id, std::nullopt) {}
+
+    /**
+     * Creates an instance which locks its appId, see [decsync_new_with_lock].
+     *
+     * @throws error if the DecSync directory is not supported or the appId is in use.
+     */
+    static instance with_lock(std::string_view decsync_dir, std::string_view sync_type,
+                              std::optional<std::string_view> collection, std::string_view own_app_id,
+                              int timeout_ms) {
+        return instance(decsync_dir, sync_type, collection, own_app_id, timeout_ms);
+    }
+
+    instance(instance&& other) noexcept
+            : handle_(std::exchange(other.handle_, nullptr)), listeners_(std::move(other.listeners_)) {}
+
+    instance& operator=(instance&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+            listeners_ = std::move(other.listeners_);
+        }
+        return *this;
+    }
+
+    instance(const instance&) = delete;
+    instance& operator=(const instance&) = delete;
+
+    ~instance() { reset(); }
+
+    /**
+     * Returns the underlying handle, to use functions of [libdecsync.h] which are not wrapped.
+     */
+    Decsync handle() const noexcept { return handle_; }
+
+    /**
+     * Extra data for the execute functions of [libdecsync.h], which calls the listeners of this
+     * instance with [extra]. It must stay alive until the call is completed, which matters for the
+     * asynchronous functions.
+     */
+    struct listener_context {
+        instance* self;
+        void* extra;
+    };
+
+    listener_context context(void* extra) noexcept { return {this, extra}; }
+
+    /**
+     * Adds a listener for the entries whose path starts with [subpath]. The first added listener
+     * whose subpath matches is called, with the path relative to [subpath]. The listener may also
+     * return void, which counts as success.
+     */
+    template <typename F>
+    void add_listener(path_ref subpath, F&& f) {
+        std::vector<std::string> path;
+        path.reserve(subpath.size());
+        for (std::size_t i = 0; i < subpath.size(); ++i) {
+            path.emplace_back(subpath[i]);
+        }
+        if constexpr (std::is_same_v<std::invoke_result_t<F&, const entry&, void*>, void>) {
+            listeners_.emplace_back(std::move(path), [f = std::forward<F>(f)](const entry& e, void* extra) mutable {
+                f(e, extra);
+                return true;
+            });
+        } else {
+            listeners_.emplace_back(std::move(path), std::forward<F>(f));
+        }
+    }
+
+    void enable_directory_cache() { decsync_enable_directory_cache(handle_); }
+
+    void set_entry(path_ref path, std::string_view key, std::string_view value) {
+        detail::c_args args(path, {key, value});
+        decsync_set_entry(handle_, args.path(), args.path_len(), args.string(0), args.string(1));
+    }
+
+    void set_entries(entries_batch& batch) {
+        if (batch.empty()) return;
+        batch.with_handles([&](DecsyncEntryWithPath* entries, int len) {
+            decsync_set_entries(handle_, entries, len);
+        });
+    }
+
+    void execute_all_new_entries(void* extra = nullptr) {
+        listener_context ctx = context(extra);
+        decsync_execute_all_new_entries(handle_, &ctx);
+    }
+
+    void execute_stored_entry(path_ref path, std::string_view key, void* extra = nullptr) {
+        detail::c_args args(path, {key});
+        listener_context ctx = context(extra);
+        decsync_execute_stored_entry(handle_, args.path(), args.path_len(), args.string(0), &ctx);
+    }
+
+    void execute_stored_entries(stored_entries_batch& batch, void* extra = nullptr) {
+        if (batch.empty()) return;
+        listener_context ctx = context(extra);
+        batch.with_handles([&](DecsyncStoredEntry* stored_entries, int len) {
+            decsync_execute_stored_entries(handle_, stored_entries, len, &ctx);
+        });
+    }
+
+    void execute_all_stored_entries_for_path_exact(path_ref path, void* extra = nullptr) {
+        detail::c_args args(path, {});
+        listener_context ctx = context(extra);
+        decsync_execute_all_stored_entries_for_path_exact(handle_, args.path(), args.path_len(), &ctx);
+    }
+
+    void execute_all_stored_entries_for_path_prefix(path_ref path, void* extra = nullptr) {
+        detail::c_args args(path, {});
+        listener_context ctx = context(extra);
+        decsync_execute_all_stored_entries_for_path_prefix(handle_, args.path(), args.path_len(), &ctx);
+    }
+
+    cursor open_cursor(path_ref prefix) {
+        detail::c_args args(prefix, {});
+        return cursor(decsync_cursor_open(handle_, args.path(), args.path_len()));
+    }
+
+    void init_stored_entries() { decsync_init_stored_entries(handle_); }
+
+    std::string latest_app_id() const {
+        char app_id[256];
+        decsync_latest_app_id(handle_, app_id, sizeof(app_id));
+        return app_id;
+    }
+
+private:
+    Decsync handle_ = nullptr;
+    std::vector<std::pair<std::vector<std::string>, listener>> listeners_;
+
+    instance(std::string_view decsync_dir, std::string_view sync_type,
+             std::optional<std::string_view> collection, std::string_view own_app_id,
+             std::optional<int> timeout_ms) {
+        std::string dir(decsync_dir);
+        std::string type(sync_type);
+        std::optional<std::string> coll = collection ? std::optional<std::string>(*collection) : std::nullopt;
+        std::string app_id(own_app_id);
+        const char* c_coll = coll ? coll->c_str() : nullptr;
+        int code = timeout_ms
+                ? decsync_new_with_lock(&handle_, dir.c_str(), type.c_str(), c_coll, app_id.c_str(), *timeout_ms)
+                : decsync_new(&handle_, dir.c_str(), type.c_str(), c_coll, app_id.c_str());
+        if (code != 0) {
+            throw error(code);
+        }
+        const char* subpath[1] {};
+        decsync_add_listener_with_success(handle_, subpath, 0, &on_entry_update);
+    }
+
+    void reset() noexcept {
+        if (handle_) {
+            decsync_free(std::exchange(handle_, nullptr));
+        }
+    }
+
+    static bool on_entry_update(const char** path, int len, const char* datetime,
+                                const char* key, const char* value, void* extra) {
+        listener_context* ctx = static_cast<listener_context*>(extra);
+        for (auto& [subpath, listener] : ctx->self->listeners_) {
+            if (subpath.size() > static_cast<std::size_t>(len)) continue;
+            std::size_t i = 0;
+            while (i < subpath.size() && subpath[i] == path[i]) {
+                ++i;
+            }
+            if (i < subpath.size()) continue;
+            int sublen = len - static_cast<int>(subpath.size());
+            return listener(entry {path_view(path + subpath.size(), sublen), datetime, key, value}, ctx->extra);
+        }
+        // Unknown paths are skipped, retrying will not help
+        return true;
+    }
+};
+
+}  // namespace decsync
+
+#endif  /* LIBDECSYNC_HPP */
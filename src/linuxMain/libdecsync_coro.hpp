@@ -0,0 +1,246 @@
+#ifndef LIBDECSYNC_CORO_HPP
+#define LIBDECSYNC_CORO_HPP
+
+#include "libdecsync.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * C++20 coroutine interface of [libdecsync.hpp], built on the asynchronous functions of
+ * [libdecsync.h]. The calls are executed on the worker thread of the instance and the awaiting
+ * coroutine does not block a thread in the meantime:
+ *
+ *     co_await decsync::co::set_entries(decsync, batch, executor);
+ *     co_await decsync::co::sync(decsync, &extra, executor);
+ *
+ * The coroutine is resumed by the executor, which is any callable taking a
+ * [std::coroutine_handle<>]. It is called on the thread which completes the call: the worker
+ * thread, or the thread calling [decsync_dispatch_async] when [decsync_set_async_on_caller_thread]
+ * is enabled. It can post the handle to the event loop of the caller. The default
+ * [inline_executor] resumes the coroutine directly.
+ *
+ * The listeners are called on the same thread as the executor, before the coroutine is resumed.
+ */
+namespace decsync {
+namespace co {
+
+/**
+ * Executor which resumes the coroutine directly on the thread which completes the call.
+ */
+struct inline_executor {
+    void operator()(std::coroutine_handle<> handle) const { handle.resume(); }
+};
+
+namespace detail {
+
+// Base of the awaitables. The coroutine is resumed by whichever of the completion of the call
+// and the end of [await_suspend] happens last, so [await_suspend] can safely clean up after
+// submitting the call.
+template <typename Executor>
+class operation {
+public:
+    bool await_ready() const noexcept { return false; }
+    void await_resume() const noexcept {}
+
+protected:
+    explicit operation(Executor executor) : executor_(std::move(executor)) {}
+
+    template <typename Submit>
+    void suspend(std::coroutine_handle<> handle, Submit&& submit) {
+        handle_ = handle;
+        submit(&on_done, static_cast<void*>(this));
+        complete();
+    }
+
+private:
+    Executor executor_;
+    std::coroutine_handle<> handle_;
+    std::atomic<bool> half_done_ {false};
+
+    static void on_done(void* self) {
+        static_cast<operation*>(self)->complete();
+    }
+
+    void complete() {
+        if (!half_done_.exchange(true)) return;
+        // The operation is destroyed when the coroutine is resumed
+        Executor executor = std::move(executor_);
+        executor(handle_);
+    }
+};
+
+}  // namespace detail
+
+/**
+ * Awaitable of [sync].
+ */
+template <typename Executor>
+class sync_operation : public detail::operation<Executor> {
+public:
+    sync_operation(instance& decsync, void* extra, Executor executor)
+            : detail::operation<Executor>(std::move(executor)), decsync_(decsync), context_(decsync.context(extra)) {}
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        this->suspend(handle, [&](void (*on_done)(void*), void* done_extra) {
+            decsync_execute_all_new_entries_async(decsync_.handle(), &context_, on_done, done_extra);
+        });
+    }
+
+private:
+    instance& decsync_;
+    instance::listener_context context_;
+};
+
+/**
+ * Awaitable of [set_entries].
+ */
+template <typename Executor>
+class set_entries_operation : public detail::operation<Executor> {
+public:
+    set_entries_operation(instance& decsync, entries_batch& batch, Executor executor)
+            : detail::operation<Executor>(std::move(executor)), decsync_(decsync), batch_(batch) {}
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        this->suspend(handle, [&](void (*on_done)(void*), void* done_extra) {
+            batch_.with_handles([&](DecsyncEntryWithPath* entries, int len) {
+                decsync_set_entries_async(decsync_.handle(), entries, len, on_done, done_extra);
+            });
+        });
+    }
+
+private:
+    instance& decsync_;
+    entries_batch& batch_;
+};
+
+/**
+ * Awaitable of [execute_stored_entries].
+ */
+template <typename Executor>
+class execute_stored_entries_operation : public detail::operation<Executor> {
+public:
+    execute_stored_entries_operation(instance& decsync, stored_entries_batch& batch, void* extra, Executor executor)
+            : detail::operation<Executor>(std::move(executor)), decsync_(decsync), batch_(batch),
+              context_(decsync.context(extra)) {}
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        this->suspend(handle, [&](void (*on_done)(void*), void* done_extra) {
+            batch_.with_handles([&](DecsyncStoredEntry* stored_entries, int len) {
+                decsync_execute_stored_entries_async(decsync_.handle(), stored_entries, len, &context_, on_done, done_extra);
+            });
+        });
+    }
+
+private:
+    instance& decsync_;
+    stored_entries_batch& batch_;
+    instance::listener_context context_;
+};
+
+/**
+ * Executes all new entries, like [instance::execute_all_new_entries].
+ */
+template <typename Executor = inline_executor>
+sync_operation<Executor> sync(instance& decsync, void* extra = nullptr, Executor executor = {}) {
+    return {decsync, extra, std::move(executor)};
+}
+
+/**
+ * Writes the entries of [batch], like [instance::set_entries]. The batch can be reused as soon as
+ * the call is submitted, so already while awaiting.
+ */
+template <typename Executor = inline_executor>
+set_entries_operation<Executor> set_entries(instance& decsync, entries_batch& batch, Executor executor = {}) {
+    return {decsync, batch, std::move(executor)};
+}
+
+/**
+ * Executes the stored entries of [batch], like [instance::execute_stored_entries].
+ */
+template <typename Executor = inline_executor>
+execute_stored_entries_operation<Executor> execute_stored_entries(
+        instance& decsync, stored_entries_batch& batch, void* extra = nullptr, Executor executor = {}) {
+    return {decsync, batch, extra, std::move(executor)};
+}
+
+/**
+ * Copy of an [entry] which outlives the listener call.
+ */
+struct owned_entry {
+    std::vector<std::string> path;
+    std::string datetime;
+    std::string key;
+    std::string value;
+};
+
+/**
+ * Asynchronous stream of the entries updated below a subpath. Every call to [next] executes the
+ * new entries and returns the ones of this stream in a batch. The stream adds a listener to the
+ * instance, so it has to be created before any other listener whose subpath also matches. After
+ * the stream is destroyed, the entries below its subpath are not executed, but kept until a later
+ * call on a new instance.
+ *
+ *     decsync::co::entry_batches articles(decsync, {"articles"});
+ *     while (running) {
+ *         for (auto& entry : co_await articles.next(executor)) { ... }
+ *     }
+ */
+class entry_batches {
+public:
+    entry_batches(instance& decsync, path_ref subpath) : decsync_(decsync), state_(std::make_shared<state>()) {
+        decsync.add_listener(subpath, [state = state_](const entry& e, void*) {
+            if (!state->active) return false;
+            state->pending.push_back(owned_entry {
+                    std::vector<std::string>(e.path.begin(), e.path.end()),
+                    std::string(e.datetime), std::string(e.key), std::string(e.value)
+            });
+            return true;
+        });
+    }
+
+    entry_batches(const entry_batches&) = delete;
+    entry_batches& operator=(const entry_batches&) = delete;
+
+    // The listener stays registered, but reports failure afterwards, such that the entries are
+    // kept for a later call instead of being dropped
+    ~entry_batches() { state_->active = false; }
+
+    template <typename Executor>
+    class next_operation : public sync_operation<Executor> {
+    public:
+        next_operation(entry_batches& batches, Executor executor)
+                : sync_operation<Executor>(batches.decsync_, nullptr, std::move(executor)), batches_(batches) {}
+
+        std::vector<owned_entry> await_resume() { return std::exchange(batches_.state_->pending, {}); }
+
+    private:
+        entry_batches& batches_;
+    };
+
+    /**
+     * Executes all new entries and returns the ones below the subpath. The batch may be empty.
+     */
+    template <typename Executor = inline_executor>
+    next_operation<Executor> next(Executor executor = {}) {
+        return {*this, std::move(executor)};
+    }
+
+private:
+    struct state {
+        std::atomic<bool> active {true};
+        std::vector<owned_entry> pending;
+    };
+
+    instance& decsync_;
+    std::shared_ptr<state> state_;
+};
+
+}  // namespace co
+}  // namespace decsync
+
+#endif  /* LIBDECSYNC_CORO_HPP */
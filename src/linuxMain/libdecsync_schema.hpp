@@ -0,0 +1,432 @@
+#ifndef LIBDECSYNC_SCHEMA_HPP
+#define LIBDECSYNC_SCHEMA_HPP
+
+#include "libdecsync.h"
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Typed bindings for the paths and keys used by the sync types "rss", "contacts" and "calendars",
+ * as defined by the items of the Kotlin library. Requires C++17 and is header-only.
+ *
+ * Every schema is a struct containing the variable parts of an entry, like the date and GUID of an
+ * article. The fixed parts of its path are known at compile time. Entries are written by [set]
+ * and executed by [execute_stored], without hand-assembled paths or JSON-quoted keys:
+ *
+ *     decsync::schema::set(decsync, rss::article_read{{2020, 8, 23}, guid}, true);
+ *
+ * Listeners are registered per schema by [add_listener] with the fixed part of the path as
+ * subpath, so the library already routes every entry to the right schema. The handler is the extra
+ * data given to the execute functions and is called with the typed entry and value. A single
+ * handler type with one overload per schema can be used for all listeners:
+ *
+ *     struct Handler {
+ *         void operator()(const rss::article_read& article, bool read) { ... }
+ *         bool operator()(const rss::feed_name& feed, const std::optional<std::string>& name) { ... }
+ *     };
+ *     decsync::schema::add_listener<rss::article_read, Handler>(decsync);
+ *
+ * A handler returning bool is registered with [decsync_add_listener_with_success].
+ */
+namespace decsync {
+namespace schema {
+
+namespace detail {
+
+/**
+ * Serializes [text] as JSON string, escaped like the Kotlin library does.
+ */
+inline std::string json_string(std::string_view text) {
+    std::string result;
+    result.reserve(text.size() + 2);
+    result += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    const char* hex = "0123456789abcdef";
+                    result += "\\u00";
+                    result += hex[(c >> 4) & 0xf];
+                    result += hex[c & 0xf];
+                } else {
+                    result += c;
+                }
+        }
+    }
+    result += '"';
+    return result;
+}
+
+inline void append_utf8(std::string& result, std::uint32_t code) {
+    if (code < 0x80) {
+        result += static_cast<char>(code);
+    } else if (code < 0x800) {
+        result += static_cast<char>(0xc0 | (code >> 6));
+        result += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        result += static_cast<char>(0xe0 | (code >> 12));
+        result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        result += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        result += static_cast<char>(0xf0 | (code >> 18));
+        result += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        result += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+inline bool parse_hex4(std::string_view text, std::size_t pos, std::uint32_t& code) {
+    if (pos + 4 > text.size()) return false;
+    const char* begin = text.data() + pos;
+    return std::from_chars(begin, begin + 4, code, 16).ptr == begin + 4;
+}
+
+/**
+ * Parses the JSON string [text]. Returns nullopt if [text] is not a JSON string.
+ */
+inline std::optional<std::string> parse_json_string(std::string_view text) {
+    if (text.size() < 2 || text.front() != '"' || text.back() != '"') return std::nullopt;
+    std::string result;
+    result.reserve(text.size() - 2);
+    for (std::size_t i = 1; i + 1 < text.size(); ++i) {
+        char c = text[i];
+        if (c != '\\') {
+            result += c;
+            continue;
+        }
+        if (++i + 1 >= text.size()) return std::nullopt;
+        switch (text[i]) {
+            case '"': result += '"'; break;
+            case '\\': result += '\\'; break;
+            case '/': result += '/'; break;
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u': {
+                std::uint32_t code;
+                if (!parse_hex4(text, i + 1, code)) return std::nullopt;
+                i += 4;
+                std::uint32_t low;
+                if (code >= 0xd800 && code < 0xdc00 && text.substr(i + 1, 2) == "\\u" &&
+                        parse_hex4(text, i + 3, low) && low >= 0xdc00 && low < 0xe000) {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    i += 6;
+                }
+                append_utf8(result, code);
+                break;
+            }
+            default: return std::nullopt;
+        }
+    }
+    return result;
+}
+
+template <typename T>
+struct json_codec;
+
+template <>
+struct json_codec<bool> {
+    static std::string to_json(bool value) { return value ? "true" : "false"; }
+    static std::optional<bool> from_json(std::string_view text) {
+        if (text == "true") return true;
+        if (text == "false") return false;
+        return std::nullopt;
+    }
+};
+
+template <>
+struct json_codec<std::string> {
+    static std::string to_json(std::string_view value) { return json_string(value); }
+    static std::optional<std::string> from_json(std::string_view text) { return parse_json_string(text); }
+};
+
+template <>
+struct json_codec<std::optional<std::string>> {
+    static std::string to_json(const std::optional<std::string>& value) {
+        return value ? json_string(*value) : "null";
+    }
+    static std::optional<std::optional<std::string>> from_json(std::string_view text) {
+        if (text == "null") return std::optional<std::string>();
+        auto value = parse_json_string(text);
+        if (!value) return std::nullopt;
+        return std::optional<std::string>(std::move(*value));
+    }
+};
+
+// Fixed-size buffer for a zero-padded number in a path
+template <std::size_t N>
+struct padded_number {
+    char text[N + 1];
+
+    explicit padded_number(int value) {
+        for (std::size_t i = N; i-- > 0; value /= 10) {
+            text[i] = static_cast<char>('0' + value % 10);
+        }
+        text[N] = '\0';
+    }
+};
+
+inline std::optional<int> parse_number(const char* text) {
+    int value;
+    const char* end = text + std::strlen(text);
+    auto result = std::from_chars(text, end, value);
+    if (result.ec != std::errc() || result.ptr != end) return std::nullopt;
+    return value;
+}
+
+template <std::size_t N>
+void copy_path(const std::array<const char*, N>& path, const char** result) {
+    for (std::size_t i = 0; i < N; ++i) {
+        result[i] = path[i];
+    }
+}
+
+template <typename Schema, typename = void>
+struct is_listenable : std::false_type {};
+
+template <typename Schema>
+struct is_listenable<Schema, std::void_t<decltype(Schema::from_entry(nullptr, 0, ""))>> : std::true_type {};
+
+template <typename Schema, typename Handler>
+using handler_result = decltype(std::declval<Handler&>()(
+        std::declval<const Schema&>(), std::declval<const typename Schema::value_type&>()));
+
+template <typename Schema, typename Handler>
+handler_result<Schema, Handler> on_entry_update(const char** path, int len, const char* key, const char* value, void* extra) {
+    auto entry = Schema::from_entry(path, len, key);
+    auto typed_value = json_codec<typename Schema::value_type>::from_json(value);
+    if (!entry || !typed_value) {
+        // Unsupported entries are skipped, retrying will not help
+        if constexpr (std::is_same_v<handler_result<Schema, Handler>, bool>) {
+            return true;
+        } else {
+            return;
+        }
+    }
+    return (*static_cast<Handler*>(extra))(*entry, *typed_value);
+}
+
+template <typename Schema, typename Handler>
+void on_entry_update_void(const char** path, int len, const char* datetime, const char* key, const char* value, void* extra) {
+    on_entry_update<Schema, Handler>(path, len, key, value, extra);
+}
+
+template <typename Schema, typename Handler>
+bool on_entry_update_bool(const char** path, int len, const char* datetime, const char* key, const char* value, void* extra) {
+    return on_entry_update<Schema, Handler>(path, len, key, value, extra);
+}
+
+}  // namespace detail
+
+/**
+ * Date of an RSS article, as used in its path.
+ */
+struct date {
+    int year;
+    int month;
+    int day;
+};
+
+/**
+ * Writes [value] for the entry [entry] and sends it to synchronized devices.
+ */
+template <typename Schema>
+void set(Decsync decsync, const Schema& entry, const typename Schema::value_type& value) {
+    std::string key = entry.key();
+    std::string json = detail::json_codec<typename Schema::value_type>::to_json(value);
+    entry.with_path([&](const char** path, int len) {
+        decsync_set_entry(decsync, path, len, key.c_str(), json.c_str());
+    });
+}
+
+/**
+ * Executes the stored value of [entry] with the listeners of [decsync].
+ */
+template <typename Schema>
+void execute_stored(Decsync decsync, const Schema& entry, void* extra) {
+    std::string key = entry.key();
+    entry.with_path([&](const char** path, int len) {
+        decsync_execute_stored_entry(decsync, path, len, key.c_str(), extra);
+    });
+}
+
+/**
+ * Adds a listener for all entries of [Schema]. The extra data given to the execute functions must
+ * point to a [Handler], which is called with the typed entry and value. Entries with an unexpected
+ * path or value are skipped.
+ */
+template <typename Schema, typename Handler>
+void add_listener(Decsync decsync) {
+    static_assert(detail::is_listenable<Schema>::value, "Schema does not support listeners");
+    const char* subpath[Schema::prefix.size() + 1];
+    detail::copy_path(Schema::prefix, subpath);
+    if constexpr (std::is_same_v<detail::handler_result<Schema, Handler>, bool>) {
+        decsync_add_listener_with_success(decsync, subpath, Schema::prefix.size(), &detail::on_entry_update_bool<Schema, Handler>);
+    } else {
+        decsync_add_listener(decsync, subpath, Schema::prefix.size(), &detail::on_entry_update_void<Schema, Handler>);
+    }
+}
+
+namespace detail {
+
+// Entry in a fixed path with a string as key
+template <typename Tag, typename Value>
+struct keyed_entry {
+    using value_type = Value;
+    static constexpr std::array<const char*, 2> prefix = Tag::path;
+
+    std::string id;
+
+    std::string key() const { return json_string(id); }
+
+    template <typename F>
+    void with_path(F&& f) const {
+        const char* path[prefix.size()];
+        copy_path(prefix, path);
+        f(path, static_cast<int>(prefix.size()));
+    }
+
+    static std::optional<keyed_entry> from_entry(const char** path, int len, const char* key) {
+        if (len != 0) return std::nullopt;
+        auto id = parse_json_string(key);
+        if (!id) return std::nullopt;
+        return keyed_entry{std::move(*id)};
+    }
+};
+
+// Boolean flag of an RSS article, stored per day
+template <typename Tag>
+struct article_flag {
+    using value_type = bool;
+    static constexpr std::array<const char*, 2> prefix = {"articles", Tag::name};
+
+    schema::date date;
+    std::string guid;
+
+    std::string key() const { return json_string(guid); }
+
+    template <typename F>
+    void with_path(F&& f) const {
+        padded_number<4> year(date.year);
+        padded_number<2> month(date.month);
+        padded_number<2> day(date.day);
+        const char* path[5] {prefix[0], prefix[1], year.text, month.text, day.text};
+        f(path, 5);
+    }
+
+    static std::optional<article_flag> from_entry(const char** path, int len, const char* key) {
+        if (len != 3) return std::nullopt;
+        auto year = parse_number(path[0]);
+        auto month = parse_number(path[1]);
+        auto day = parse_number(path[2]);
+        auto guid = parse_json_string(key);
+        if (!year || !month || !day || !guid) return std::nullopt;
+        return article_flag{{*year, *month, *day}, std::move(*guid)};
+    }
+};
+
+// Resource of a contacts or calendars collection, stored in its own path
+struct resource {
+    using value_type = std::optional<std::string>;
+    static constexpr std::array<const char*, 1> prefix = {"resources"};
+
+    std::string uid;
+
+    std::string key() const { return "null"; }
+
+    template <typename F>
+    void with_path(F&& f) const {
+        const char* path[2] {prefix[0], uid.c_str()};
+        f(path, 2);
+    }
+
+    static std::optional<resource> from_entry(const char** path, int len, const char* key) {
+        if (len != 1 || std::strcmp(key, "null") != 0) return std::nullopt;
+        return resource{path[0]};
+    }
+};
+
+// Property of a collection, stored under a fixed key in the path "info". All properties share
+// the same path, so they are only written and executed, but do not have their own listener.
+template <typename Tag, typename Value>
+struct info_entry {
+    using value_type = Value;
+
+    std::string key() const { return json_string(Tag::key); }
+
+    template <typename F>
+    void with_path(F&& f) const {
+        const char* path[1] {"info"};
+        f(path, 1);
+    }
+};
+
+struct read_tag { static constexpr const char* name = "read"; };
+struct marked_tag { static constexpr const char* name = "marked"; };
+struct feed_subscriptions_tag { static constexpr std::array<const char*, 2> path = {"feeds", "subscriptions"}; };
+struct feed_names_tag { static constexpr std::array<const char*, 2> path = {"feeds", "names"}; };
+struct feed_categories_tag { static constexpr std::array<const char*, 2> path = {"feeds", "categories"}; };
+struct category_names_tag { static constexpr std::array<const char*, 2> path = {"categories", "names"}; };
+struct category_parents_tag { static constexpr std::array<const char*, 2> path = {"categories", "parents"}; };
+struct name_tag { static constexpr const char* key = "name"; };
+struct deleted_tag { static constexpr const char* key = "deleted"; };
+struct color_tag { static constexpr const char* key = "color"; };
+
+}  // namespace detail
+
+/**
+ * Schemas of the sync type "rss". The ids are the GUID of an article, the link of a feed and the
+ * catId of a category.
+ */
+namespace rss {
+using article_read = detail::article_flag<detail::read_tag>;
+using article_marked = detail::article_flag<detail::marked_tag>;
+using feed_subscription = detail::keyed_entry<detail::feed_subscriptions_tag, bool>;
+using feed_name = detail::keyed_entry<detail::feed_names_tag, std::optional<std::string>>;
+using feed_category = detail::keyed_entry<detail::feed_categories_tag, std::optional<std::string>>;
+using category_name = detail::keyed_entry<detail::category_names_tag, std::string>;
+using category_parent = detail::keyed_entry<detail::category_parents_tag, std::optional<std::string>>;
+}  // namespace rss
+
+/**
+ * Schemas of the sync type "contacts". The value of a resource is its vCard, or null when it is
+ * deleted.
+ */
+namespace contacts {
+using resource = detail::resource;
+using info_name = detail::info_entry<detail::name_tag, std::string>;
+using info_deleted = detail::info_entry<detail::deleted_tag, bool>;
+}  // namespace contacts
+
+/**
+ * Schemas of the sync type "calendars". The value of a resource is its iCalendar, or null when it
+ * is deleted.
+ */
+namespace calendars {
+using resource = detail::resource;
+using info_name = detail::info_entry<detail::name_tag, std::string>;
+using info_deleted = detail::info_entry<detail::deleted_tag, bool>;
+using info_color = detail::info_entry<detail::color_tag, std::optional<std::string>>;
+}  // namespace calendars
+
+}  // namespace schema
+}  // namespace decsync
+
+#endif  /* LIBDECSYNC_SCHEMA_HPP */
@@ -0,0 +1,65 @@
+package org.decsync.library
+
+import kotlin.random.Random
+import kotlin.time.Duration
+import kotlin.time.ExperimentalTime
+import kotlin.time.measureTimedValue
+
+// Compares sequential and parallel Diff.calc. Not part of the tests, run it with
+// ./gradlew diffBenchmark
+
+private val comparator = compareBy<Pair<Int, Int>> { it.first }
+
+// Same shape as the lists in DiffTest
+private fun lists(size: Int, random: Random): Pair<List<Pair<Int, Int>>, List<Pair<Int, Int>>> {
+    val oldList = mutableListOf<Pair<Int, Int>>()
+    val newList = mutableListOf<Pair<Int, Int>>()
+    for (id in 0 until size) {
+        when (random.nextInt(4)) {
+            0 -> newList += id to 0
+            1 -> oldList += id to 0
+            2 -> {
+                oldList += id to 0
+                newList += id to 1
+            }
+            else -> {
+                oldList += id to 0
+                newList += id to 0
+            }
+        }
+    }
+    return oldList to newList
+}
+
+// Best of a few runs, so a single slow run does not skew the result
+@ExperimentalTime
+private fun <T> best(runs: Int, block: () -> T): Pair<T, Duration> {
+    var result = measureTimedValue(block)
+    repeat(runs - 1) {
+        val next = measureTimedValue(block)
+        if (next.duration < result.duration) {
+            result = next
+        }
+    }
+    return result.value to result.duration
+}
+
+@ExperimentalTime
+fun main(args: Array<String>) {
+    val parallelism = args.getOrNull(0)?.toInt() ?: 4
+    val runs = args.getOrNull(1)?.toInt() ?: 5
+    val random = Random(0)
+    val pool = WorkerPool(parallelism)
+    try {
+        for (size in listOf(10_000, 100_000, 1_000_000)) {
+            val (oldList, newList) = lists(size, random)
+            val (expected, sequentialTime) = best(runs) { Diff.calc(oldList, newList, comparator) }
+            val (parallel, parallelTime) = best(runs) { Diff.calc(oldList, newList, comparator, parallelism) }
+            val (pooled, pooledTime) = best(runs) { Diff.calc(oldList, newList, comparator, pool) }
+            check(parallel == expected && pooled == expected) { "Parallel diff of $size items differs from the sequential one" }
+            println("Diff of $size items: sequential $sequentialTime, parallel $parallelTime, reused pool $pooledTime ($parallelism threads)")
+        }
+    } finally {
+        pool.close()
+    }
+}
@@ -0,0 +1,227 @@
+/**
+ * libdecsync - AsyncWorker.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+import kotlin.native.concurrent.AtomicInt
+import kotlin.native.concurrent.ThreadLocal
+import kotlin.native.concurrent.Worker
+
+/**
+ * Executes the asynchronous calls of a C [Decsync] handle on a library-owned worker thread, one at
+ * a time and in the order in which they are submitted.
+ *
+ * A call is a sequence which is iterated on the worker. It yields the work which belongs on the
+ * thread of the caller, like calling the listeners of a batch of entries. By default, this work and
+ * the completion callback are executed on the worker as well. If [onCallerThread] is enabled, they
+ * are queued instead and executed by [dispatch] on the thread of the caller, after which the worker
+ * continues the call. The disk I/O and parsing thus stay on the worker, which does not hold any
+ * lock while it waits for the caller. The [signal] becomes readable whenever a call completes or
+ * something is queued.
+ */
+internal class AsyncWorker {
+    private class Call(val steps: Iterator<() -> Unit>, val onCallerThread: Boolean, private val onDone: () -> Unit) {
+        private val isDone = AtomicInt(0)
+
+        // Calls the completion callback once, also when the call is cancelled
+        fun finish() {
+            if (isDone.compareAndSet(0, 1)) onDone()
+        }
+    }
+
+    // Work queued for the caller. The call continues or finishes after the work.
+    private class Pending(val call: Call, val work: () -> Unit, val isLast: Boolean)
+
+    private val lock = ReadWriteLock()
+    private var worker: Worker? = null
+    // The first call is executed, unless it waits for the caller
+    private val calls = ArrayDeque<Call>()
+    private var isActive = false
+    private var isDisposed = false
+    private var pending = mutableListOf<Pending>()
+    val signal = EventSignal()
+    // Set on the caller thread and read on the worker
+    private val mOnCallerThread = AtomicInt(0)
+    var onCallerThread: Boolean
+        get() = mOnCallerThread.value != 0
+        set(value) {
+            mOnCallerThread.value = if (value) 1 else 0
+        }
+    // Number of calls of the wrapped listeners, to detect whether a call executed anything
+    val listenerCalls = AtomicInt(0)
+
+    /**
+     * Submits a call which executes [task] at once. In [onCallerThread] mode, the listeners called
+     * by the task are queued for the caller and considered successful, so the task must not depend
+     * on their return values.
+     */
+    fun submit(task: () -> Unit, onDone: () -> Unit) =
+            submit(sequence<() -> Unit> { task() }, onDone)
+
+    fun submit(steps: Sequence<() -> Unit>, onDone: () -> Unit) {
+        val call = Call(steps.iterator(), onCallerThread, onDone)
+        val start = lock.write {
+            calls.addLast(call)
+            if (isActive) {
+                null
+            } else {
+                isActive = true
+                worker ?: Worker.start(name = "decsync-async").also { worker = it }
+            }
+        }
+        start?.executeAfter(0L) { pump() }
+    }
+
+    // Executes the steps of the calls on the worker, until a call waits for the caller
+    private fun pump() {
+        AsyncContext.current = this
+        while (true) {
+            val call = lock.write {
+                if (isDisposed) return@write null
+                calls.firstOrNull().also { if (it == null) isActive = false }
+            } ?: return
+            AsyncContext.deferTo = if (call.onCallerThread) this else null
+            val work = try {
+                if (call.steps.hasNext()) call.steps.next() else null
+            } catch (e: Throwable) {
+                Log.e("Asynchronous call failed: ${e.message}")
+                null
+            } finally {
+                AsyncContext.deferTo = null
+            }
+            val deferred = AsyncContext.deferred.also { AsyncContext.deferred = mutableListOf() }
+            val isLast = work == null
+            if (isLast) {
+                lock.write { calls.removeFirst() }
+            }
+            if (call.onCallerThread) {
+                post(Pending(call, {
+                    deferred.forEach { it() }
+                    work?.invoke()
+                }, isLast))
+                // The call is continued by [dispatch]
+                if (!isLast) return
+            } else {
+                execute { work?.invoke() }
+                if (isLast) {
+                    call.finish()
+                    signal.signal()
+                }
+            }
+        }
+    }
+
+    private fun execute(work: () -> Unit) {
+        try {
+            work()
+        } catch (e: Throwable) {
+            Log.e("Asynchronous call failed: ${e.message}")
+        }
+    }
+
+    private fun post(item: Pending) {
+        lock.write {
+            pending.add(item)
+        }
+        signal.signal()
+    }
+
+    /**
+     * Executes all queued work and completion callbacks on the current thread and resets the
+     * [signal]. Returns the number of executed items.
+     */
+    fun dispatch(): Int {
+        signal.reset()
+        val items = lock.write {
+            pending.also { pending = mutableListOf() }
+        }
+        val previous = AsyncContext.current
+        AsyncContext.current = this
+        try {
+            for (item in items) {
+                execute(item.work)
+                if (item.isLast) {
+                    item.call.finish()
+                } else {
+                    lock.write { if (isDisposed) null else worker }?.executeAfter(0L) { pump() }
+                }
+            }
+        } finally {
+            AsyncContext.current = previous
+        }
+        return items.size
+    }
+
+    /**
+     * Wraps a listener such that its calls are counted in [listenerCalls]. In [onCallerThread] mode,
+     * the calls made during a step of a call are queued for the caller, with the entry copied by
+     * [snapshot].
+     */
+    fun <E> counting(
+            listener: (List<String>, E, V) -> Boolean,
+            snapshot: (E) -> E = { it }
+    ): (List<String>, E, V) -> Boolean =
+            { path, entry, extra ->
+                if (AsyncContext.deferTo === this) {
+                    val entryCopy = snapshot(entry)
+                    AsyncContext.deferred.add {
+                        listenerCalls.increment()
+                        listener(path, entryCopy, extra)
+                    }
+                    true
+                } else {
+                    listenerCalls.increment()
+                    listener(path, entry, extra)
+                }
+            }
+
+    /**
+     * Waits for the step which is executed and stops the worker thread. The calls which are not
+     * completed are cancelled: their completion callbacks are called on the current thread, without
+     * executing the rest of the calls. As it waits for the worker, it must not be called from a
+     * listener or a completion callback.
+     */
+    fun dispose() {
+        check(AsyncContext.current !== this) {
+            "A Decsync instance cannot be freed from its own listener or completion function"
+        }
+        lock.write {
+            isDisposed = true
+            worker
+        }?.requestTermination()?.result
+        val (cancelledCalls, cancelledItems) = lock.write {
+            Pair(calls.toList(), pending).also {
+                calls.clear()
+                pending = mutableListOf()
+            }
+        }
+        cancelledItems.forEach { it.call.finish() }
+        cancelledCalls.forEach { it.finish() }
+        signal.dispose()
+        lock.dispose()
+    }
+}
+
+@ThreadLocal
+private object AsyncContext {
+    // The instance whose work is executed on this thread
+    var current: AsyncWorker? = null
+    // The instance to which the listener calls on this thread are deferred, and the deferred calls
+    var deferTo: AsyncWorker? = null
+    var deferred = mutableListOf<() -> Unit>()
+}
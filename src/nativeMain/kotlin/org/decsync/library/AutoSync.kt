@@ -0,0 +1,101 @@
+/**
+ * libdecsync - AutoSync.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlin.native.concurrent.Worker
+
+/**
+ * Schedules synchronizations automatically. A synchronization is started by [trigger], e.g. when a
+ * change is detected, and otherwise by polling. The polling interval starts at [minIntervalMillis]
+ * and is doubled after every synchronization without changes, up to [maxIntervalMillis]. It is
+ * reset after a synchronization with changes.
+ *
+ * [runSync] starts a synchronization and calls its argument on completion, passing whether anything
+ * changed. At most one synchronization runs at a time; triggers during a synchronization cause
+ * another one afterwards.
+ */
+internal class AutoSync(
+        private val minIntervalMillis: Long,
+        private val maxIntervalMillis: Long,
+        private val runSync: (onSynced: (changed: Boolean) -> Unit) -> Unit
+) {
+    private val worker = Worker.start(name = "decsync-auto-sync")
+
+    // Only used on the worker
+    private var interval = minIntervalMillis
+    private var generation = 0
+    private var isSyncing = false
+    private var isRequested = false
+
+    init {
+        post(0L) { startSync() }
+    }
+
+    fun trigger() {
+        post(0L) {
+            interval = minIntervalMillis
+            startSync()
+        }
+    }
+
+    private fun post(delayMillis: Long, job: () -> Unit) {
+        try {
+            worker.executeAfter(delayMillis * 1000) { job() }
+        } catch (e: IllegalStateException) {
+            // The worker is already terminated
+        }
+    }
+
+    private fun startSync() {
+        // Cancel the scheduled poll
+        generation++
+        if (isSyncing) {
+            isRequested = true
+            return
+        }
+        isSyncing = true
+        runSync { changed ->
+            post(0L) { onSynced(changed) }
+        }
+    }
+
+    private fun onSynced(changed: Boolean) {
+        isSyncing = false
+        interval = if (changed) minIntervalMillis else minOf(2 * interval, maxIntervalMillis)
+        if (isRequested) {
+            isRequested = false
+            startSync()
+            return
+        }
+        val current = generation
+        post(interval) {
+            if (generation == current) {
+                startSync()
+            }
+        }
+    }
+
+    /**
+     * Stops scheduling synchronizations. A running synchronization is not interrupted.
+     */
+    fun dispose() {
+        worker.requestTermination(processScheduledJobs = false).result
+    }
+}
@@ -22,8 +22,6 @@ import kotlinx.cinterop.*
 import kotlinx.serialization.json.JsonElement
 import kotlinx.serialization.json.JsonNull
 import kotlin.math.min
-import kotlin.native.concurrent.freeze
-import kotlin.native.concurrent.InvalidMutabilityException
 
 typealias CArray<T> = CPointer<CPointerVarOf<T>>
 typealias CString = CPointer<ByteVar>
@@ -33,10 +31,23 @@ typealias V = COpaquePointer
 actual sealed class DecsyncException(val errorCode: Int) : Exception()
 class InvalidInfoException : DecsyncException(1)
 class UnsupportedVersionException : DecsyncException(2)
+class AppLockedException : DecsyncException(3)
 
 actual fun getInvalidInfoException(e: Exception): DecsyncException = InvalidInfoException()
 actual fun getUnsupportedVersionException(requiredVersion: Int, supportedVersion: Int): DecsyncException = UnsupportedVersionException()
 
+private const val MAX_POOLED_READERS = 8
+
+/**
+ * The state behind a C [Decsync] handle. A handle can be shared between threads: writing calls are
+ * serialized, while reading calls run concurrently.
+ *
+ * Writing calls share one cached [Decsync] instance, so its directory cache is kept between calls.
+ * The directory cache is not thread-safe, so concurrent reading calls cannot share an instance.
+ * Instead, they borrow one from a pool of idle read instances, so their caches are reused by later
+ * reading calls on any thread. A write invalidates the pooled instances, as their caches may miss
+ * the written files.
+ */
 @ExperimentalStdlibApi
 private class NativeDecsyncInfo(
         val decsyncDir: String,
@@ -44,19 +55,189 @@ private class NativeDecsyncInfo(
         val collection: String?,
         val ownAppId: String
 ) {
+    private val lock = ReadWriteLock()
+    private var writeDecsync: Decsync<V>? = null
+    // Only changed while holding the write lock
+    private var generation = 0
+    private val readPoolLock = ReadWriteLock()
+    private val readPool = mutableListOf<Pair<Int, Decsync<V>>>()
+    val async = AsyncWorker()
+    private val watcherLock = ReadWriteLock()
+    private var watcher: DirectoryWatcher? = null
+    var appLock: DirectoryLock? = null
+    private val autoSyncLock = ReadWriteLock()
+    private var autoSync: AutoSync? = null
+    private var directoryCache: DirectoryCache? = null
+
+    // Same directory as used by getDecsyncSubdir
+    private fun subdirPath(): String {
+        var dir = "$decsyncDir/${Url.encode(syncType)}"
+        if (collection != null) {
+            dir += "/${Url.encode(collection)}"
+        }
+        return dir
+    }
+
+    /**
+     * Locks the local directory of [ownAppId], such that no other instance can use the same appId.
+     *
+     * @throws AppLockedException if the lock is not acquired within [timeoutMillis] ms.
+     */
+    fun lockApp(timeoutMillis: Int) {
+        val path = "${subdirPath()}/local/${Url.encode(ownAppId)}"
+        appLock = lockDirectory(path, timeoutMillis) ?: throw AppLockedException()
+    }
+
     val listeners: MutableList<Pair<List<String>, (path: List<String>, entry: Decsync.Entry, extra: V) -> Boolean>> = mutableListOf()
     val multiListeners: MutableList<Pair<List<String>, (path: List<String>, entries: List<Decsync.Entry>, extra: V) -> Boolean>> = mutableListOf()
 
-    fun addListener(subpath: List<String>, onEntryUpdate: (path: List<String>, entry: Decsync.Entry, extra: V) -> Boolean) {
-        listeners += Pair(subpath, onEntryUpdate)
+    fun addListener(subpath: List<String>, onEntryUpdate: (path: List<String>, entry: Decsync.Entry, extra: V) -> Boolean) = lock.write {
+        val listener = async.counting(onEntryUpdate)
+        listeners += Pair(subpath, listener)
+        writeDecsync?.addListenerWithSuccess(subpath, listener)
+        generation++
+    }
+
+    fun addMultiListener(subpath: List<String>, onEntriesUpdate: (path: List<String>, entries: List<Decsync.Entry>, extra: V) -> Boolean) = lock.write {
+        // The list is modified by the caller afterwards
+        val listener = async.counting(onEntriesUpdate) { it.toList() }
+        multiListeners += Pair(subpath, listener)
+        writeDecsync?.addMultiListenerWithSuccess(subpath, listener)
+        generation++
+    }
+
+    fun <R> write(action: (Decsync<V>) -> R): R = lock.write {
+        val decsync = writeDecsync ?: toDecsync().also { writeDecsync = it }
+        generation++
+        action(decsync)
+    }
+
+    fun <R> read(action: (Decsync<V>) -> R): R = lock.read {
+        val current = generation
+        val decsync = readPoolLock.write {
+            var pooled: Decsync<V>? = null
+            while (pooled == null && readPool.isNotEmpty()) {
+                val (instanceGeneration, instance) = readPool.removeAt(readPool.size - 1)
+                if (instanceGeneration == current) pooled = instance
+            }
+            pooled
+        } ?: toDecsync()
+        try {
+            action(decsync)
+        } finally {
+            readPoolLock.write {
+                if (readPool.size < MAX_POOLED_READERS) {
+                    readPool += Pair(current, decsync)
+                }
+            }
+        }
+    }
+
+    /**
+     * Opens a cursor on its own instance. Every step takes the read lock again, so writing calls
+     * are not blocked between two steps.
+     */
+    fun openCursor(prefix: List<String>): NativeCursor = lock.read {
+        NativeCursor(this, toDecsync().openStoredEntriesCursor(prefix))
+    }
+
+    fun <R> readLocked(action: () -> R): R = lock.read(action)
+
+    /**
+     * Steps of executing the new entries on the [async] worker. Every step reads a batch while
+     * holding the write lock and yields the call of its listeners, which may be executed on another
+     * thread without the lock. If another writing call ran in between, the batch is compared with
+     * the stored entries again before it is stored.
+     */
+    fun executeAllNewEntriesSteps(extra: V): Sequence<() -> Unit> = sequence {
+        resetNotifyFd()
+        var decsync: Decsync<V>? = null
+        var batches: Iterator<DecsyncInst.NewEntriesBatch>? = null
+        var batch: DecsyncInst.NewEntriesBatch? = null
+        var stepGeneration = 0
+        while (true) {
+            val next = write { current ->
+                val iterator = batches ?: current.newEntryBatches(extra).iterator().also {
+                    decsync = current
+                    batches = it
+                }
+                // The generation is increased once by this step itself
+                batch?.recheck = generation != stepGeneration + 1
+                val result = if (iterator.hasNext()) iterator.next() else null
+                stepGeneration = generation
+                result
+            } ?: break
+            batch = next
+            val owner = decsync!!
+            yield { owner.executeBatch(next, extra) }
+        }
+    }
+
+    /**
+     * Uses a persistent [DirectoryCache] in the local directory for all new instances.
+     */
+    fun enableDirectoryCache() = lock.write {
+        if (directoryCache == null) {
+            directoryCache = DirectoryCache(decsyncDir, "${subdirPath()}/local/.decsync-cache")
+            writeDecsync = null
+            generation++
+        }
+    }
+
+    private fun getWatcher(): DirectoryWatcher = watcherLock.write {
+        watcher ?: DirectoryWatcher("${subdirPath()}/new-entries", Url.encode(ownAppId)).also { watcher = it }
+    }
+
+    fun getNotifyFd(): Int = getWatcher().fd
+
+    /**
+     * Executes the new entries automatically on the [async] worker, when a change is detected and
+     * otherwise by polling with a backoff between [minIntervalMillis] and [maxIntervalMillis]. The
+     * minimal interval is at least 1 ms and the maximal interval at least the minimal one.
+     */
+    fun startAutoSync(extra: V, minIntervalMillis: Int, maxIntervalMillis: Int) = autoSyncLock.write {
+        autoSync?.dispose()
+        val min = maxOf(minIntervalMillis, 1).toLong()
+        val max = maxOf(maxIntervalMillis.toLong(), min)
+        val current = AutoSync(min, max) { onSynced ->
+            val listenerCalls = async.listenerCalls.value
+            async.submit(executeAllNewEntriesSteps(extra)) {
+                onSynced(async.listenerCalls.value != listenerCalls)
+            }
+        }
+        autoSync = current
+        getWatcher().onChange = { current.trigger() }
+    }
+
+    fun stopAutoSync() = autoSyncLock.write {
+        watcherLock.read { watcher }?.onChange = null
+        autoSync?.dispose()
+        autoSync = null
     }
 
-    fun addMultiListener(subpath: List<String>, onEntriesUpdate: (path: List<String>, entries: List<Decsync.Entry>, extra: V) -> Boolean) {
-        multiListeners += Pair(subpath, onEntriesUpdate)
+    // Reset before executing the new entries, such that changes during the execution are signaled
+    fun resetNotifyFd() = watcherLock.read {
+        watcher?.reset()
+    }
+
+    fun dispose() {
+        stopAutoSync()
+        autoSyncLock.dispose()
+        watcherLock.write { watcher }?.dispose()
+        watcherLock.dispose()
+        async.dispose()
+        lock.write { writeDecsync?.flush() }
+        directoryCache?.let {
+            it.save()
+            it.dispose()
+        }
+        lock.dispose()
+        readPoolLock.dispose()
+        appLock?.release()
     }
 
     fun toDecsync(): Decsync<V> {
-        val nativeDecsyncDir = nativeFileFromPath(decsyncDir)
+        val nativeDecsyncDir = nativeFileFromPath(decsyncDir, decsyncDir.takeLastWhile { it != '/' }, directoryCache)
         val localDir = getDecsyncSubdir(nativeDecsyncDir, syncType, collection).child("local", ownAppId)
         return Decsync<V>(nativeDecsyncDir, localDir, syncType, collection, ownAppId).also {
             for ((subpath, onEntryUpdate) in listeners) {
@@ -69,54 +250,134 @@ private class NativeDecsyncInfo(
     }
 }
 
+/**
+ * The state behind a C [DecsyncCursor] handle. The C strings of the current entry are allocated in
+ * [arena] and stay valid until the next step.
+ */
 @ExperimentalStdlibApi
-private fun getDecsync(decsync: V): Decsync<V> {
-    try {
-        return decsync.asStableRef<NativeDecsyncInfo>().get().toDecsync()
-    } catch (e: IncorrectDereferenceException) {
-        Log.e("DecSync object not finalized. The method decsync_init_done has to be called after adding all the listeners in multithreaded applications.")
-        throw e
+private class NativeCursor(val info: NativeDecsyncInfo, val cursor: StoredEntriesCursor) {
+    private val arena = Arena()
+
+    fun next(
+            path: CPointer<CPointerVar<CPointerVar<ByteVar>>>,
+            len: CPointer<IntVar>,
+            datetime: CPointer<CPointerVar<ByteVar>>,
+            key: CPointer<CPointerVar<ByteVar>>,
+            value: CPointer<CPointerVar<ByteVar>>
+    ): Boolean {
+        arena.clear()
+        val entryWithPath = info.readLocked { cursor.next() } ?: return false
+        val entry = entryWithPath.entry
+        val cPath = arena.allocArray<CPointerVar<ByteVar>>(entryWithPath.path.size)
+        for (i in entryWithPath.path.indices) {
+            cPath[i] = entryWithPath.path[i].cstr.getPointer(arena)
+        }
+        path.pointed.value = cPath
+        len.pointed.value = entryWithPath.path.size
+        datetime.pointed.value = entry.datetime.cstr.getPointer(arena)
+        key.pointed.value = entry.keyText.text.cstr.getPointer(arena)
+        value.pointed.value = entry.valueText.text.cstr.getPointer(arena)
+        return true
+    }
+
+    fun dispose() {
+        cursor.close()
+        arena.clear()
     }
 }
 
 @ExperimentalStdlibApi
-@CName(externName = "decsync_so_new")
-fun decsync(
+private fun <R> writeDecsync(decsync: V, action: (Decsync<V>) -> R): R =
+        decsync.asStableRef<NativeDecsyncInfo>().get().write(action)
+
+@ExperimentalStdlibApi
+private fun <R> readDecsync(decsync: V, action: (Decsync<V>) -> R): R =
+        decsync.asStableRef<NativeDecsyncInfo>().get().read(action)
+
+typealias OnDone = CPointer<CFunction<(V?) -> Unit>>
+
+@ExperimentalStdlibApi
+private fun submitAsync(decsync: V, onDone: OnDone?, doneExtra: V?, task: (NativeDecsyncInfo) -> Unit) {
+    val info = decsync.asStableRef<NativeDecsyncInfo>().get()
+    info.async.submit({ task(info) }) { onDone?.invoke(doneExtra) }
+}
+
+@ExperimentalStdlibApi
+private fun newDecsync(
         decsync: CArray<V>,
         decsyncDirOrEmpty: String?,
         syncType: String,
         collectionOrEmpty: String?,
-        ownAppId: String
+        ownAppId: String,
+        lockTimeoutMillis: Int?
 ): Int {
     val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
     val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    val info = NativeDecsyncInfo(decsyncDir, syncType, collection, ownAppId)
     return try {
-        decsync[0] = StableRef.create<NativeDecsyncInfo>(
-                NativeDecsyncInfo(decsyncDir, syncType, collection, ownAppId)
-        ).asCPointer()
+        if (lockTimeoutMillis != null) {
+            info.lockApp(lockTimeoutMillis)
+        }
+        // Create the shared instance directly, such that configuration errors are reported here
+        // and reading calls never have to initialize the local info
+        info.write {}
+        decsync[0] = StableRef.create(info).asCPointer()
         0
     } catch (e: DecsyncException) {
+        info.dispose()
         e.errorCode
+    } catch (e: Exception) {
+        // Other exceptions, like a directory which cannot be opened, must not cross the C boundary
+        Log.e("Failed to create instance: ${e.message}")
+        info.dispose()
+        4
     }
 }
 
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_new")
+fun decsync(
+        decsync: CArray<V>,
+        decsyncDirOrEmpty: String?,
+        syncType: String,
+        collectionOrEmpty: String?,
+        ownAppId: String
+): Int = newDecsync(decsync, decsyncDirOrEmpty, syncType, collectionOrEmpty, ownAppId, null)
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_new_with_lock")
+fun decsyncWithLock(
+        decsync: CArray<V>,
+        decsyncDirOrEmpty: String?,
+        syncType: String,
+        collectionOrEmpty: String?,
+        ownAppId: String,
+        timeoutMillis: Int
+): Int = newDecsync(decsync, decsyncDirOrEmpty, syncType, collectionOrEmpty, ownAppId, timeoutMillis)
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_enable_directory_cache")
+fun enableDirectoryCache(decsync: V) =
+        decsync.asStableRef<NativeDecsyncInfo>().get().enableDirectoryCache()
+
+// No longer needed, as an instance can always be shared between threads
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_init_done")
-fun decsyncInitDone(decsync: V) {
-    decsync.asStableRef<NativeDecsyncInfo>().get().freeze()
-}
+fun decsyncInitDone(decsync: V) {}
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_free")
 fun decsyncFree(decsync: V) {
-    decsync.asStableRef<NativeDecsyncInfo>().dispose()
+    val stableRef = decsync.asStableRef<NativeDecsyncInfo>()
+    stableRef.get().dispose()
+    stableRef.dispose()
 }
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_entry_with_path_new")
 fun decsyncEntryWithPath(path: CPath, len: Int, key: String, value: String): V =
         StableRef.create(
-                Decsync.EntryWithPath(toPath(path, len), parseJson(key), parseJson(value))
+                Decsync.EntryWithPath(toPath(path, len), Decsync.Entry.fromText(key, value))
         ).asCPointer()
 
 @ExperimentalStdlibApi
@@ -128,7 +389,7 @@ fun decsyncEntryWithPathFree(entryWithPath: V) =
 @CName(externName = "decsync_so_entry_new")
 fun decsyncEntryWithPath(key: String, value: String): V =
         StableRef.create(
-                Decsync.Entry(parseJson(key), parseJson(value))
+                Decsync.Entry.fromText(key, value)
         ).asCPointer()
 
 @ExperimentalStdlibApi
@@ -151,60 +412,52 @@ fun decsyncStoredEntry(storedEntry: V) =
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_add_listener")
 fun addListener(decsync: V, subpath: CPath, len: Int, onEntryUpdate: CPointer<CFunction<(CPath, Int, CString, CString, CString, V) -> Unit>>) {
-    try {
-        decsync.asStableRef<NativeDecsyncInfo>().get().addListener(toPath(subpath, len)) { path, entry, extra ->
-            memScoped {
-                val cPath = allocArray<CPointerVarOf<CString>>(path.size)
-                for (i in path.indices) {
-                    cPath[i] = path[i].cstr.ptr
-                }
-                val cDatetime = entry.datetime.cstr.ptr
-                val cKey = entry.key.toString().cstr.ptr
-                val cValue = entry.value.toString().cstr.ptr
-                onEntryUpdate(cPath, path.size, cDatetime, cKey, cValue, extra)
-                true
+    decsync.asStableRef<NativeDecsyncInfo>().get().addListener(toPath(subpath, len)) { path, entry, extra ->
+        memScoped {
+            val cPath = allocArray<CPointerVarOf<CString>>(path.size)
+            for (i in path.indices) {
+                cPath[i] = path[i].cstr.ptr
             }
+            val cDatetime = entry.datetime.cstr.ptr
+            val cKey = entry.keyText.text.cstr.ptr
+            val cValue = entry.valueText.text.cstr.ptr
+            onEntryUpdate(cPath, path.size, cDatetime, cKey, cValue, extra)
+            true
         }
-    } catch (e: InvalidMutabilityException) {
-        Log.e("Could not add listener: all listeners should be added before calling decsync_init_done")
-        throw e
     }
 }
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_add_listener_with_success")
 fun addListenerWithSuccess(decsync: V, subpath: CPath, len: Int, onEntryUpdate: CPointer<CFunction<(CPath, Int, CString, CString, CString, V) -> Boolean>>) {
-    try {
-        decsync.asStableRef<NativeDecsyncInfo>().get().addListener(toPath(subpath, len)) { path, entry, extra ->
-            memScoped {
-                val cPath = allocArray<CPointerVarOf<CString>>(path.size)
-                for (i in path.indices) {
-                    cPath[i] = path[i].cstr.ptr
-                }
-                val cDatetime = entry.datetime.cstr.ptr
-                val cKey = entry.key.toString().cstr.ptr
-                val cValue = entry.value.toString().cstr.ptr
-                onEntryUpdate(cPath, path.size, cDatetime, cKey, cValue, extra)
+    decsync.asStableRef<NativeDecsyncInfo>().get().addListener(toPath(subpath, len)) { path, entry, extra ->
+        memScoped {
+            val cPath = allocArray<CPointerVarOf<CString>>(path.size)
+            for (i in path.indices) {
+                cPath[i] = path[i].cstr.ptr
             }
+            val cDatetime = entry.datetime.cstr.ptr
+            val cKey = entry.keyText.text.cstr.ptr
+            val cValue = entry.valueText.text.cstr.ptr
+            onEntryUpdate(cPath, path.size, cDatetime, cKey, cValue, extra)
         }
-    } catch (e: InvalidMutabilityException) {
-        Log.e("Could not add listener: all listeners should be added before calling decsync_init_done")
-        throw e
     }
 }
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_set_entry")
-fun setEntry(decsync: V, path: CPath, len: Int, key: String, value: String) =
-        getDecsync(decsync).setEntry(toPath(path, len), parseJson(key), parseJson(value))
+fun setEntry(decsync: V, path: CPath, len: Int, key: String, value: String) {
+    val entries = listOf(Decsync.Entry.fromText(key, value))
+    writeDecsync(decsync) { it.setEntriesForPath(toPath(path, len), entries) }
+}
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_set_entries")
 fun setEntries(decsync: V, entriesWithPath: CArray<V>, len: Int) =
         toList(entriesWithPath, len).map {
             it.asStableRef<Decsync.EntryWithPath>().get()
-        }.let {
-            getDecsync(decsync).setEntries(it)
+        }.let { entries ->
+            writeDecsync(decsync) { it.setEntries(entries) }
         }
 
 @ExperimentalStdlibApi
@@ -215,14 +468,32 @@ fun setEntriesForPath(decsync: V,
 ) =
         toList(entries, len_entries).map {
             it.asStableRef<Decsync.Entry>().get()
-        }.let {
-            getDecsync(decsync).setEntriesForPath(toPath(path, len_path), it)
+        }.let { entryList ->
+            writeDecsync(decsync) { it.setEntriesForPath(toPath(path, len_path), entryList) }
         }
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_execute_all_new_entries")
-fun executeAllNewEntries(decsync: V, extra: V) =
-        getDecsync(decsync).executeAllNewEntries(extra)
+fun executeAllNewEntries(decsync: V, extra: V) {
+    val info = decsync.asStableRef<NativeDecsyncInfo>().get()
+    info.resetNotifyFd()
+    info.write { it.executeAllNewEntries(extra) }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_get_notify_fd")
+fun getNotifyFd(decsync: V): Int =
+        decsync.asStableRef<NativeDecsyncInfo>().get().getNotifyFd()
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_start_auto_sync")
+fun startAutoSync(decsync: V, extra: V, minIntervalMillis: Int, maxIntervalMillis: Int) =
+        decsync.asStableRef<NativeDecsyncInfo>().get().startAutoSync(extra, minIntervalMillis, maxIntervalMillis)
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_stop_auto_sync")
+fun stopAutoSync(decsync: V) =
+        decsync.asStableRef<NativeDecsyncInfo>().get().stopAutoSync()
 
 @ExperimentalStdlibApi
 @CName (externName = "decsync_so_execute_stored_entry")
@@ -230,21 +501,25 @@ fun executeStoredEntry(decsync: V,
                        path: CPath, len: Int,
                        key: String,
                        extra: V) =
-        getDecsync(decsync).executeStoredEntry(
-                toPath(path, len),
-                parseJson(key),
-                extra)
+        readDecsync(decsync) {
+            it.executeStoredEntry(
+                    toPath(path, len),
+                    JsonText.fromText(key),
+                    extra)
+        }
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_execute_stored_entries")
 fun executeStoredEntries(decsync: V,
                          storedEntries: CArray<V>, len: Int,
                          extra: V) =
-        getDecsync(decsync).executeStoredEntries(
-                toList(storedEntries, len).map {
-                    it.asStableRef<Decsync.StoredEntry>().get()
-                },
-                extra)
+        readDecsync(decsync) {
+            it.executeStoredEntries(
+                    toList(storedEntries, len).map { storedEntry ->
+                        storedEntry.asStableRef<Decsync.StoredEntry>().get()
+                    },
+                    extra)
+        }
 
 @ExperimentalStdlibApi
 @CName (externName = "decsync_so_execute_stored_entries_for_path_exact")
@@ -252,20 +527,24 @@ fun executeStoredEntriesForPathExact(decsync: V,
                                      path: CPath, len_path: Int,
                                      extra: V,
                                      keys: CArray<CString>, len_keys: Int) =
-        getDecsync(decsync).executeStoredEntriesForPathExact(
-                toPath(path, len_path),
-                extra,
-                toList(keys, len_keys).map { parseJson(it.toKString()) })
+        readDecsync(decsync) {
+            it.executeStoredEntriesForPathExact(
+                    toPath(path, len_path),
+                    extra,
+                    toList(keys, len_keys).map { key -> JsonText.fromText(key.toKString()) })
+        }
 
 @ExperimentalStdlibApi
 @CName (externName = "decsync_so_execute_all_stored_entries_for_path_exact")
 fun executeAllStoredEntriesForPathExact(decsync: V,
                                         path: CPath, len: Int,
                                         extra: V) =
-        getDecsync(decsync).executeStoredEntriesForPathExact(
-                toPath(path, len),
-                extra,
-                null)
+        readDecsync(decsync) {
+            it.executeStoredEntriesForPathExact(
+                    toPath(path, len),
+                    extra,
+                    null)
+        }
 
 @ExperimentalStdlibApi
 @CName (externName = "decsync_so_execute_stored_entries_for_path_prefix")
@@ -273,20 +552,24 @@ fun executeStoredEntriesForPathPrefix(decsync: V,
                                       path: CPath, len_path: Int,
                                       extra: V,
                                       keys: CArray<CString>, len_keys: Int) =
-        getDecsync(decsync).executeStoredEntriesForPathPrefix(
-                toPath(path, len_path),
-                extra,
-                toList(keys, len_keys).map { parseJson(it.toKString()) })
+        readDecsync(decsync) {
+            it.executeStoredEntriesForPathPrefix(
+                    toPath(path, len_path),
+                    extra,
+                    toList(keys, len_keys).map { key -> JsonText.fromText(key.toKString()) })
+        }
 
 @ExperimentalStdlibApi
 @CName (externName = "decsync_so_execute_all_stored_entries_for_path_prefix")
 fun executeAllStoredEntriesForPathPrefix(decsync: V,
                                          path: CPath, len: Int,
                                          extra: V) =
-        getDecsync(decsync).executeStoredEntriesForPathPrefix(
-                toPath(path, len),
-                extra,
-                null)
+        readDecsync(decsync) {
+            it.executeStoredEntriesForPathPrefix(
+                    toPath(path, len),
+                    extra,
+                    null)
+        }
 
 @ExperimentalStdlibApi
 @CName (externName = "decsync_so_execute_stored_entries_for_path")
@@ -305,12 +588,127 @@ fun executeAllStoredEntriesForPath(decsync: V,
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_init_stored_entries")
-fun initStoredEntries(decsync: V) = getDecsync(decsync).initStoredEntries()
+fun initStoredEntries(decsync: V) = writeDecsync(decsync) { it.initStoredEntries() }
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_latest_app_id")
 fun latestAppId(decsync: V, appId: CString, len: Int) =
-        fillBuffer(getDecsync(decsync).latestAppId(), appId, len)
+        fillBuffer(readDecsync(decsync) { it.latestAppId() }, appId, len)
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_changes_since")
+fun changesSince(decsync: V, watermark: Long, onChange: CPointer<CFunction<(CPath, Int, CString, CString, CString, V?) -> Unit>>, extra: V?): Long {
+    // The callback is called without the lock, such that it can write entries
+    val changes = readDecsync(decsync) { it.changesSince(watermark) }
+    if (changes.isStale) return -1
+    for ((path, entry) in changes.entries) {
+        memScoped {
+            val cPath = allocArray<CPointerVarOf<CString>>(path.size)
+            for (i in path.indices) {
+                cPath[i] = path[i].cstr.ptr
+            }
+            val cDatetime = entry.datetime.cstr.ptr
+            val cKey = entry.keyText.text.cstr.ptr
+            val cValue = entry.valueText.text.cstr.ptr
+            onChange(cPath, path.size, cDatetime, cKey, cValue, extra)
+        }
+    }
+    return changes.watermark
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_current_changes_watermark")
+fun currentChangesWatermark(decsync: V): Long =
+        // It may start a new journal
+        writeDecsync(decsync) { it.currentChangesWatermark() }
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_cursor_open")
+fun cursorOpen(decsync: V, prefix: CPath, len: Int): V =
+        StableRef.create(
+                decsync.asStableRef<NativeDecsyncInfo>().get().openCursor(toPath(prefix, len))
+        ).asCPointer()
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_cursor_next")
+fun cursorNext(
+        cursor: V,
+        path: CPointer<CPointerVar<CPointerVar<ByteVar>>>,
+        len: CPointer<IntVar>,
+        datetime: CPointer<CPointerVar<ByteVar>>,
+        key: CPointer<CPointerVar<ByteVar>>,
+        value: CPointer<CPointerVar<ByteVar>>
+): Boolean =
+        cursor.asStableRef<NativeCursor>().get().next(path, len, datetime, key, value)
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_cursor_close")
+fun cursorClose(cursor: V) {
+    val stableRef = cursor.asStableRef<NativeCursor>()
+    stableRef.get().dispose()
+    stableRef.dispose()
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_set_entries_async")
+fun setEntriesAsync(decsync: V, entriesWithPath: CArray<V>, len: Int, onDone: OnDone?, doneExtra: V?) {
+    val entries = toList(entriesWithPath, len).map {
+        it.asStableRef<Decsync.EntryWithPath>().get()
+    }
+    submitAsync(decsync, onDone, doneExtra) { info ->
+        info.write { it.setEntries(entries) }
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_execute_all_new_entries_async")
+fun executeAllNewEntriesAsync(decsync: V, extra: V, onDone: OnDone?, doneExtra: V?) {
+    val info = decsync.asStableRef<NativeDecsyncInfo>().get()
+    info.async.submit(info.executeAllNewEntriesSteps(extra)) { onDone?.invoke(doneExtra) }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_execute_stored_entries_async")
+fun executeStoredEntriesAsync(decsync: V, storedEntries: CArray<V>, len: Int, extra: V, onDone: OnDone?, doneExtra: V?) {
+    val storedEntryList = toList(storedEntries, len).map {
+        it.asStableRef<Decsync.StoredEntry>().get()
+    }
+    submitAsync(decsync, onDone, doneExtra) { info ->
+        info.read { it.executeStoredEntries(storedEntryList, extra) }
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_execute_all_stored_entries_for_path_prefix_async")
+fun executeAllStoredEntriesForPathPrefixAsync(decsync: V, path: CPath, len: Int, extra: V, onDone: OnDone?, doneExtra: V?) {
+    val prefix = toPath(path, len)
+    submitAsync(decsync, onDone, doneExtra) { info ->
+        info.read { it.executeStoredEntriesForPathPrefix(prefix, extra, null) }
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_init_stored_entries_async")
+fun initStoredEntriesAsync(decsync: V, onDone: OnDone?, doneExtra: V?) =
+        submitAsync(decsync, onDone, doneExtra) { info ->
+            info.write { it.initStoredEntries() }
+        }
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_set_async_on_caller_thread")
+fun setAsyncOnCallerThread(decsync: V, onCallerThread: Boolean) {
+    decsync.asStableRef<NativeDecsyncInfo>().get().async.onCallerThread = onCallerThread
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_get_async_fd")
+fun getAsyncFd(decsync: V): Int =
+        decsync.asStableRef<NativeDecsyncInfo>().get().async.signal.fd
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_dispatch_async")
+fun dispatchAsync(decsync: V): Int =
+        decsync.asStableRef<NativeDecsyncInfo>().get().async.dispatch()
 
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_get_static_info")
@@ -334,6 +732,121 @@ fun checkDecsyncInfoC(decsyncDirOrEmpty: String?): Int {
     }
 }
 
+// Unlike nativeFileFromPath, a non-existing path is treated as a file instead of a directory
+private fun archiveFileFromPath(path: String): NativeFile {
+    val parentPath = if ('/' in path) path.dropLastWhile { it != '/' }.dropLast(1).ifEmpty { "/" } else "."
+    return nativeFileFromPath(parentPath).child(path.takeLastWhile { it != '/' })
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_export_archive")
+fun exportArchiveC(decsyncDirOrEmpty: String?, syncType: String, collectionOrEmpty: String?, archive: String, appIdOrEmpty: String?): Int {
+    val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
+    val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    val appId = if (appIdOrEmpty.isNullOrEmpty()) null else appIdOrEmpty
+    return try {
+        Decsync.exportArchive(nativeFileFromPath(decsyncDir), syncType, collection, archiveFileFromPath(archive), appId)
+        0
+    } catch (e: Exception) {
+        Log.e(e.message ?: "Failed to export $archive")
+        -1
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_import_archive")
+fun importArchiveC(decsyncDirOrEmpty: String?, syncType: String, collectionOrEmpty: String?, archive: String): Int {
+    val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
+    val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    return try {
+        Decsync.importArchive(nativeFileFromPath(decsyncDir), syncType, collection, archiveFileFromPath(archive))
+        0
+    } catch (e: DecsyncException) {
+        e.errorCode
+    } catch (e: Exception) {
+        Log.e(e.message ?: "Failed to import $archive")
+        -1
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_maintenance_stats")
+fun maintenanceStatsC(decsyncDirOrEmpty: String?, syncType: String, collectionOrEmpty: String?, threads: Int,
+                      onStats: CPointer<CFunction<(CString, CString, CPath, Int, Int, Int, Int, V?) -> Unit>>, extra: V?) {
+    val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
+    val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    val stats = DecsyncMaintenance.stats(nativeFileFromPath(decsyncDir), syncType, collection, threads)
+    for (fileStats in stats) {
+        memScoped {
+            val path = fileStats.path
+            val cPath = allocArray<CPointerVarOf<CString>>(path.size)
+            for (i in path.indices) {
+                cPath[i] = path[i].cstr.ptr
+            }
+            onStats(fileStats.kind.cstr.ptr, fileStats.appId.cstr.ptr, cPath, path.size,
+                    fileStats.bytes, fileStats.entries, fileStats.deadEntries, extra)
+        }
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_maintenance_verify")
+fun maintenanceVerifyC(decsyncDirOrEmpty: String?, syncType: String, collectionOrEmpty: String?, threads: Int,
+                       onProblem: CPointer<CFunction<(CString, Int, CString, V?) -> Unit>>, extra: V?): Int {
+    val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
+    val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    val problems = DecsyncMaintenance.verify(nativeFileFromPath(decsyncDir), syncType, collection, threads)
+    for (problem in problems) {
+        memScoped {
+            onProblem(problem.file.cstr.ptr, problem.line ?: 0, problem.message.cstr.ptr, extra)
+        }
+    }
+    return problems.size
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_maintenance_lag")
+fun maintenanceLagC(decsyncDirOrEmpty: String?, syncType: String, collectionOrEmpty: String?, threads: Int,
+                    onLag: CPointer<CFunction<(CString, CString, Long, V?) -> Unit>>, extra: V?) {
+    val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
+    val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    val lags = DecsyncMaintenance.lag(nativeFileFromPath(decsyncDir), syncType, collection, threads)
+    for (lag in lags) {
+        memScoped {
+            onLag(lag.appId.cstr.ptr, lag.peerAppId.cstr.ptr, lag.unreadBytes, extra)
+        }
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_maintenance_compact")
+fun maintenanceCompactC(decsyncDirOrEmpty: String?, syncType: String, collectionOrEmpty: String?, appIdOrEmpty: String?, threads: Int): Int {
+    val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
+    val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    val appId = if (appIdOrEmpty.isNullOrEmpty()) null else appIdOrEmpty
+    return try {
+        DecsyncMaintenance.compact(nativeFileFromPath(decsyncDir), syncType, collection, appId, threads)
+    } catch (e: Exception) {
+        Log.e(e.message ?: "Failed to compact $syncType/$collection")
+        -1
+    }
+}
+
+@ExperimentalStdlibApi
+@CName(externName = "decsync_so_maintenance_prune")
+fun maintenancePruneC(decsyncDirOrEmpty: String?, syncType: String, collectionOrEmpty: String?, before: String,
+                      onPruned: CPointer<CFunction<(CString, V?) -> Unit>>, extra: V?): Int {
+    val decsyncDir = if (decsyncDirOrEmpty.isNullOrEmpty()) getDefaultDecsyncDir() else decsyncDirOrEmpty
+    val collection = if (collectionOrEmpty.isNullOrEmpty()) null else collectionOrEmpty
+    val appIds = DecsyncMaintenance.prune(nativeFileFromPath(decsyncDir), syncType, collection, before)
+    for (appId in appIds) {
+        memScoped {
+            onPruned(appId.cstr.ptr, extra)
+        }
+    }
+    return appIds.size
+}
+
 @ExperimentalStdlibApi
 @CName(externName = "decsync_so_list_decsync_collections")
 fun listDecsyncCollectionsC(decsyncDirOrEmpty: String?, syncType: String, collections: CArray<CString>, max_len: Int): Int {
@@ -0,0 +1,327 @@
+/**
+ * libdecsync - DirectoryCache.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+import platform.posix.*
+
+private const val MAGIC = 0x44534332 // "DSC2"
+private const val RECORD_LISTING: Byte = 0
+private const val RECORD_KEYS: Byte = 1
+// Directories modified this recently are not cached, as a change in the same timestamp could go
+// unnoticed, especially on file systems with a coarse timestamp resolution
+private const val RACY_NANOS = 2_000_000_000L
+
+/**
+ * A persistent cache of the directory listings below [root], stored in the file [cacheFile]. A
+ * cached listing is used as long as the modification time of its directory is unchanged, such that
+ * a new process does not have to read every directory again. Similarly, it keeps the keys in every
+ * read file, together with its size and modification time. A file without any requested key is
+ * then skipped after a single stat.
+ *
+ * The cache file is memory-mapped and only the directories which are actually listed are decoded.
+ * It is replaced atomically by [save], so multiple processes can share it.
+ */
+internal class DirectoryCache(private val root: String, private val cacheFile: String) {
+    class Child(val name: String, val isDirectory: Boolean)
+    private class Listing(val mtime: Long, val children: List<Child>)
+    private class Keys(val mtime: Long, val size: Long, val keys: Set<String>)
+
+    private val lock = ReadWriteLock()
+    private val mapped = mapFile(cacheFile)
+    private val offsets = HashMap<String, Int>()
+    private val keyOffsets = HashMap<String, Int>()
+    private val updates = HashMap<String, Listing>()
+    private val keyUpdates = HashMap<String, Keys>()
+
+    init {
+        if (mapped != null) {
+            try {
+                index(mapped)
+            } catch (e: Exception) {
+                Log.w("Ignoring invalid directory cache $cacheFile")
+                offsets.clear()
+                keyOffsets.clear()
+            }
+        }
+    }
+
+    private fun relativePath(path: String): String = path.removePrefix(root)
+
+    /**
+     * Returns the cached children of the directory [path] if they are still up to date.
+     */
+    fun listChildren(path: String): List<Child>? {
+        val mtime = fileStatCustom(path)?.mtimeNanos ?: return null
+        val key = relativePath(path)
+        val listing = lock.read { updates[key] } ?: lock.read {
+            val offset = offsets[key] ?: return@read null
+            try {
+                Reader(mapped!!, offset).readListing()
+            } catch (e: Exception) {
+                null
+            }
+        }
+        return listing?.takeIf { it.mtime == mtime }?.children
+    }
+
+    /**
+     * Stores the [children] of the directory [path], which are read after its modification time
+     * [mtime] was determined.
+     */
+    fun store(path: String, mtime: Long, children: List<Child>) {
+        if (isRacy(mtime)) return
+        lock.write {
+            updates[relativePath(path)] = Listing(mtime, children)
+        }
+    }
+
+    /**
+     * Returns the cached keys of the file [path] if its size and modification time are unchanged.
+     * The function of the result stores the keys after the file is read.
+     */
+    fun keyIndex(path: String): KeyIndex? {
+        val stat = fileStatCustom(path) ?: return null
+        val key = relativePath(path)
+        val cached = lock.read { keyUpdates[key] } ?: lock.read {
+            val offset = keyOffsets[key] ?: return@read null
+            try {
+                Reader(mapped!!, offset).readKeys()
+            } catch (e: Exception) {
+                null
+            }
+        }
+        val keys = cached?.takeIf { it.mtime == stat.mtimeNanos && it.size == stat.size }?.keys
+        return KeyIndex(keys) { readKeys ->
+            if (!isRacy(stat.mtimeNanos)) {
+                lock.write {
+                    keyUpdates[key] = Keys(stat.mtimeNanos, stat.size, readKeys)
+                }
+            }
+        }
+    }
+
+    private fun isRacy(mtime: Long): Boolean {
+        val now = time(null).toLong() * 1_000_000_000L
+        return mtime > now - RACY_NANOS
+    }
+
+    /**
+     * Writes the cache file if anything is changed.
+     */
+    fun save() = lock.write {
+        if (updates.isEmpty() && keyUpdates.isEmpty()) return@write
+        val writer = Writer()
+        writer.writeInt(MAGIC)
+        for ((key, listing) in updates) {
+            writer.writeListing(key, listing)
+        }
+        for ((key, keys) in keyUpdates) {
+            writer.writeKeys(key, keys)
+        }
+        if (mapped != null) {
+            for ((key, offset) in offsets) {
+                if (key in updates) continue
+                val listing = try {
+                    Reader(mapped, offset).readListing()
+                } catch (e: Exception) {
+                    continue
+                }
+                writer.writeListing(key, listing)
+            }
+            for ((key, offset) in keyOffsets) {
+                if (key in keyUpdates) continue
+                val keys = try {
+                    Reader(mapped, offset).readKeys()
+                } catch (e: Exception) {
+                    continue
+                }
+                writer.writeKeys(key, keys)
+            }
+        }
+        val tmpFile = "$cacheFile.tmp-${getpid()}"
+        mkdirs(cacheFile.dropLastWhile { it != '/' }.dropLast(1))
+        RealFileImpl(tmpFile, "").write(writer.toByteArray())
+        if (rename(tmpFile, cacheFile) != 0) {
+            // Windows does not replace existing files
+            unlink(cacheFile)
+            if (rename(tmpFile, cacheFile) != 0) {
+                unlink(tmpFile)
+            }
+        }
+        updates.clear()
+        keyUpdates.clear()
+    }
+
+    fun dispose() {
+        mapped?.close()
+        lock.dispose()
+    }
+
+    private fun index(mapped: MappedFile) {
+        val reader = Reader(mapped, 0)
+        if (reader.readInt() != MAGIC) throw Exception("Invalid magic")
+        while (reader.offset < mapped.size) {
+            val offset = reader.offset
+            val type = reader.readByte()
+            val key = reader.readString()
+            when (type) {
+                RECORD_LISTING -> {
+                    reader.readLong()
+                    repeat(reader.readInt()) {
+                        reader.skipString()
+                        reader.readByte()
+                    }
+                    offsets[key] = offset
+                }
+                RECORD_KEYS -> {
+                    reader.readLong()
+                    reader.readLong()
+                    repeat(reader.readInt()) {
+                        reader.skipString()
+                    }
+                    keyOffsets[key] = offset
+                }
+                else -> throw Exception("Invalid record type $type")
+            }
+        }
+    }
+
+    // Listing record: type 0, path, mtime, number of children and for every child its name and
+    // whether it is a directory.
+    // Keys record: type 1, path, mtime, size, number of keys and every key as JSON text.
+    // All numbers are little-endian.
+    private class Reader(private val mapped: MappedFile, var offset: Int) {
+        fun readByte(): Byte {
+            if (offset >= mapped.size) throw Exception("Unexpected end of directory cache")
+            return mapped.data[offset++]
+        }
+
+        fun readInt(): Int {
+            var result = 0
+            for (i in 0 until 4) {
+                result = result or ((readByte().toInt() and 0xff) shl (8 * i))
+            }
+            return result
+        }
+
+        fun readLong(): Long {
+            val low = readInt().toLong() and 0xffffffffL
+            val high = readInt().toLong()
+            return (high shl 32) or low
+        }
+
+        fun readString(): String {
+            val len = readInt()
+            if (len < 0 || offset + len > mapped.size) throw Exception("Invalid string in directory cache")
+            val bytes = (mapped.data + offset)!!.readBytes(len)
+            offset += len
+            return bytes.decodeToString()
+        }
+
+        fun skipString() {
+            val len = readInt()
+            if (len < 0 || offset + len > mapped.size) throw Exception("Invalid string in directory cache")
+            offset += len
+        }
+
+        fun readListing(): Listing {
+            readByte()
+            skipString()
+            val mtime = readLong()
+            val children = List(readInt()) {
+                val name = readString()
+                Child(name, readByte() != 0.toByte())
+            }
+            return Listing(mtime, children)
+        }
+
+        fun readKeys(): Keys {
+            readByte()
+            skipString()
+            val mtime = readLong()
+            val size = readLong()
+            val keys = HashSet<String>()
+            repeat(readInt()) {
+                keys += readString()
+            }
+            return Keys(mtime, size, keys)
+        }
+    }
+
+    private class Writer {
+        private var bytes = ByteArray(4096)
+        private var size = 0
+
+        private fun ensure(extra: Int) {
+            if (size + extra > bytes.size) {
+                bytes = bytes.copyOf(maxOf(2 * bytes.size, size + extra))
+            }
+        }
+
+        fun writeByte(value: Byte) {
+            ensure(1)
+            bytes[size++] = value
+        }
+
+        fun writeInt(value: Int) {
+            for (i in 0 until 4) {
+                writeByte((value shr (8 * i)).toByte())
+            }
+        }
+
+        fun writeLong(value: Long) {
+            writeInt(value.toInt())
+            writeInt((value shr 32).toInt())
+        }
+
+        fun writeString(value: String) {
+            val encoded = value.encodeToByteArray()
+            writeInt(encoded.size)
+            ensure(encoded.size)
+            encoded.copyInto(bytes, size)
+            size += encoded.size
+        }
+
+        fun writeListing(key: String, listing: Listing) {
+            writeByte(RECORD_LISTING)
+            writeString(key)
+            writeLong(listing.mtime)
+            writeInt(listing.children.size)
+            for (child in listing.children) {
+                writeString(child.name)
+                writeByte(if (child.isDirectory) 1 else 0)
+            }
+        }
+
+        fun writeKeys(key: String, keys: Keys) {
+            writeByte(RECORD_KEYS)
+            writeString(key)
+            writeLong(keys.mtime)
+            writeLong(keys.size)
+            writeInt(keys.keys.size)
+            for (value in keys.keys) {
+                writeString(value)
+            }
+        }
+
+        fun toByteArray(): ByteArray = bytes.copyOf(size)
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * libdecsync - DirectoryLock.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+/**
+ * An exclusive lock on a directory, which is held until [release] is called. It also excludes
+ * other processes, but it is only advisory: it does not prevent access by processes which do not
+ * lock the directory.
+ */
+internal expect class DirectoryLock {
+    fun release()
+}
+
+/**
+ * Locks the directory [path], which is created if it does not exist. If the directory is locked by
+ * someone else, it waits at most [timeoutMillis] ms for the lock, or indefinitely if it is
+ * negative. Returns null if the lock is not acquired in time.
+ */
+internal expect fun lockDirectory(path: String, timeoutMillis: Int): DirectoryLock?
+
+// Time between two attempts when waiting for a lock
+internal const val LOCK_RETRY_MILLIS = 50
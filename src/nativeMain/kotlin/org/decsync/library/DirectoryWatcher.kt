@@ -0,0 +1,34 @@
+/**
+ * libdecsync - DirectoryWatcher.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+/**
+ * Watches the directory [dir] and all its subdirectories, except for its direct child
+ * [excludedName]. The file descriptor [fd] becomes readable when a file in it changes, until
+ * [reset] is called. Changes are debounced, such that a burst of writes results in a single
+ * wakeup. Additionally, [onChange] is called on the thread of the watcher. On platforms without
+ * support, or when the directory cannot be watched, [fd] is -1 and [onChange] is never called.
+ */
+internal expect class DirectoryWatcher(dir: String, excludedName: String) {
+    val fd: Int
+    var onChange: (() -> Unit)?
+    fun reset()
+    fun dispose()
+}
@@ -0,0 +1,31 @@
+/**
+ * libdecsync - EventSignal.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+package org.decsync.library
+
+/**
+ * A file descriptor which becomes readable when [signal] is called, until [reset] is called. It can
+ * be used in a poll or event loop. On platforms without support, [fd] is -1 and the signal is
+ * ignored.
+ */
+internal expect class EventSignal() {
+    val fd: Int
+    fun signal()
+    fun reset()
+    fun dispose()
+}
@@ -0,0 +1,34 @@
+/**
+ * libdecsync - MappedFile.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+
+/**
+ * The read-only contents of a file, which are memory-mapped if supported.
+ */
+internal class MappedFile(val data: CPointer<ByteVar>, val size: Int, private val onClose: () -> Unit) {
+    fun close() = onClose()
+}
+
+/**
+ * Returns the mapped contents of the file [path], or null if it does not exist or is empty.
+ */
+internal expect fun mapFile(path: String): MappedFile?
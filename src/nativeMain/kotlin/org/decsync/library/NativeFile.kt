@@ -24,7 +24,13 @@ import platform.posix.*
 const val createModeDir = S_IRWXU or S_IRGRP or S_IXGRP or S_IROTH or S_IXOTH
 const val createModeFile = S_IRUSR or S_IWUSR or S_IRGRP or S_IROTH
 
-class RealFileImpl(private val path: String, name: String) : RealFile(name) {
+class RealFileImpl internal constructor(
+        private val path: String,
+        name: String,
+        private val cache: DirectoryCache?
+) : RealFile(name) {
+    constructor(path: String, name: String) : this(path, name, null)
+
     override fun delete() {
         unlink(path)
     }
@@ -39,17 +45,18 @@ class RealFileImpl(private val path: String, name: String) : RealFile(name) {
         fstat(fd, fileStat.ptr)
         return fileStat.st_size.toInt()
     }
-    override fun read(readBytes: Int): ByteArray {
+    override fun read(readBytes: Int, maxLength: Int): ByteArray {
         val fd = open(path, openFlagsBinary or O_RDONLY)
         if (fd < 0) throw Exception("Failed to open $path")
-        val len = length(fd)
-        if (len <= readBytes) {
+        val len = minOf(length(fd) - readBytes, maxLength)
+        if (len <= 0) {
+            close(fd)
             return ByteArray(0)
         }
-        val buf = ByteArray(len - readBytes)
+        val buf = ByteArray(len)
         lseek(fd, readBytes.off_t(), SEEK_SET)
         buf.usePinned { bufPin ->
-            readCustom(fd, bufPin.addressOf(0), (len - readBytes))
+            readCustom(fd, bufPin.addressOf(0), len)
         }
         close(fd)
         return buf
@@ -64,61 +71,83 @@ class RealFileImpl(private val path: String, name: String) : RealFile(name) {
         close(fd)
     }
 
+    override fun keyIndex(): KeyIndex? = cache?.keyIndex(path)
+
     override fun toString(): String = path
 }
 
-class RealDirectoryImpl(private val path: String, name: String) : RealDirectory(name) {
+class RealDirectoryImpl internal constructor(
+        private val path: String,
+        name: String,
+        private val cache: DirectoryCache?
+) : RealDirectory(name) {
+    constructor(path: String, name: String) : this(path, name, null)
+
     override fun listChildren(): List<RealNode> {
+        cache?.listChildren(path)?.let { children ->
+            return children.map { child ->
+                val childPath = "$path/${child.name}"
+                if (child.isDirectory) RealDirectoryImpl(childPath, child.name, cache) else RealFileImpl(childPath, child.name, cache)
+            }
+        }
+        // Determine the modification time first, such that concurrent changes invalidate the cache
+        val mtime = cache?.let { fileStatCustom(path)?.mtimeNanos }
         val result = mutableListOf<RealNode>()
         val d = opendir(path) ?: return emptyList()
         while (true) {
             val dir = readdir(d)?.pointed ?: break
             val name = dir.d_name.toKString()
             if (name == "." || name == "..") continue
-            result += realNodeFromPath("$path/$name", name) ?: continue
+            result += realNodeFromPath("$path/$name", name, cache) ?: continue
         }
         closedir(d)
+        if (cache != null && mtime != null) {
+            cache.store(path, mtime, result.map { DirectoryCache.Child(it.name, it is RealDirectory) })
+        }
         return result
     }
     override fun delete() {
         rmdir(path)
     }
     override fun mkfile(name: String, text: ByteArray): RealFile {
-        val file = RealFileImpl("$path/$name", name)
+        val file = RealFileImpl("$path/$name", name, cache)
         file.write(text)
         return file
     }
     override fun mkdir(name: String): RealDirectory {
         mkdirCustom("$path/$name", createModeDir)
-        return RealDirectoryImpl("$path/$name", name)
+        return RealDirectoryImpl("$path/$name", name, cache)
     }
 
     override fun toString(): String = path
 }
 
-fun nativeFileFromPath(path: String, name: String = path.takeLastWhile { it != '/' }): NativeFile {
-    val node = realNodeFromPath(path, name) ?: run {
+fun nativeFileFromPath(path: String, name: String = path.takeLastWhile { it != '/' }): NativeFile =
+        nativeFileFromPath(path, name, null)
+
+internal fun nativeFileFromPath(path: String, name: String, cache: DirectoryCache?): NativeFile {
+    val node = realNodeFromPath(path, name, cache) ?: run {
         mkdirs(path)
-        RealDirectoryImpl(path, name)
+        RealDirectoryImpl(path, name, cache)
     }
     return NativeFile(node, null)
 }
 
-private fun mkdirs(path: String) {
+internal fun mkdirs(path: String) {
     if (path.isEmpty() || realNodeFromPath(path) != null) return
     val parentPath = path.dropLastWhile { it != '/' }.dropLast(1)
     mkdirs(parentPath)
     mkdirCustom(path, createModeDir)
 }
 
-private fun realNodeFromPath(path: String, name: String = path.takeLastWhile { it != '/' }): RealNode? = memScoped {
+private fun realNodeFromPath(path: String, name: String = path.takeLastWhile { it != '/' }, cache: DirectoryCache? = null): RealNode? = memScoped {
     val fileStat = alloc<stat>()
     if (stat(path, fileStat.ptr) != 0) {
         null
     } else {
         when (fileStat.st_mode.toInt() and S_IFMT) {
-            S_IFREG -> RealFileImpl(path, name)
-            S_IFDIR -> RealDirectoryImpl(path, name)
+            S_IFREG -> RealFileImpl(path, name, cache)
+            S_IFDIR -> RealDirectoryImpl(path, name, cache)
             else -> throw Exception("Unknown file type for file $path")
         }
     }
@@ -0,0 +1,55 @@
+/**
+ * libdecsync - SerialExecutor.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlin.native.concurrent.AtomicInt
+import kotlin.native.concurrent.TransferMode
+import kotlin.native.concurrent.Worker
+
+private const val POOL_SIZE = 4
+
+private val pool: List<Worker> by lazy {
+    List(POOL_SIZE) { Worker.start(name = "decsync-background-$it") }
+}
+private val nextWorker = AtomicInt(0)
+
+internal actual class SerialExecutor actual constructor() {
+    // All tasks of an executor run on the same worker, which executes its jobs in order
+    private val worker = pool[(nextWorker.addAndGet(1) and Int.MAX_VALUE) % POOL_SIZE]
+
+    actual fun execute(f: () -> Unit) {
+        worker.executeAfter(0L) {
+            try {
+                f()
+            } catch (e: Throwable) {
+                Log.e("Background task failed: ${e.message}")
+            }
+        }
+    }
+
+    actual fun flush() {
+        // The empty job would wait behind the calling job forever
+        if (Worker.current == worker) {
+            throw IllegalStateException("flush called from a task on the same background thread")
+        }
+        // All previous jobs are completed when this empty job is executed
+        worker.execute(TransferMode.SAFE, {}) {}.result
+    }
+}
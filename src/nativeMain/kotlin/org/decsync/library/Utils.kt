@@ -27,6 +27,8 @@ expect fun mkdirCustom(path: String, mode: Int)
 expect fun readCustom(fd: Int, buf: CValuesRef<*>?, len: Int)
 expect fun writeCustom(fd: Int, buf: CValuesRef<*>?, size: Int)
 expect fun gethostnameCustom(name: CValuesRef<ByteVar>, size: Int): Int
+internal expect fun fileStatCustom(path: String): FileStat?
+expect fun gmtimeCustom(time: CValuesRef<time_tVar>, result: CValuesRef<tm>): Boolean
 
 actual fun getDeviceName(): String {
     val name = ByteArray(256)
@@ -38,21 +40,22 @@ actual fun getDeviceName(): String {
     return name.toKString()
 }
 
-actual fun currentDatetime(): String {
-    val now = time(null)
-    val tm = gmtime(cValuesOf(now))?.pointed ?: throw Exception("Failed to get current time")
+actual fun currentDatetime(): String = memScoped {
+    val now = alloc<time_tVar>()
+    now.value = time(null)
+    val tm = alloc<tm>()
+    if (!gmtimeCustom(now.ptr, tm.ptr)) throw Exception("Failed to get current time")
     val year = (tm.tm_year + 1900).toString()
     val mon = (tm.tm_mon + 1).toString().padStart(2, '0')
     val day = tm.tm_mday.toString().padStart(2, '0')
     val hour = tm.tm_hour.toString().padStart(2, '0')
     val min = tm.tm_min.toString().padStart(2, '0')
     val sec = tm.tm_sec.toString().padStart(2, '0')
-    return "$year-$mon-${day}T$hour:$min:$sec"
+    "$year-$mon-${day}T$hour:$min:$sec"
 }
 
 actual fun byteArrayToString(input: ByteArray): String = input.toKString()
 
-// Native is fast enough
-actual fun async(f: () -> Unit) = f()
+internal class FileStat(val mtimeNanos: Long, val size: Long)
 
 expect fun getDefaultDecsyncDir(): String
\ No newline at end of file
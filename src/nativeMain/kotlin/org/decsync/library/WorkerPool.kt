@@ -0,0 +1,57 @@
+/**
+ * libdecsync - WorkerPool.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlin.native.concurrent.AtomicInt
+import kotlin.native.concurrent.TransferMode
+import kotlin.native.concurrent.Worker
+
+internal actual class WorkerPool actual constructor(actual val size: Int) {
+    private val workers = List(size) { Worker.start(name = "decsync-pool-$it") }
+
+    actual fun runAll(tasks: List<() -> Unit>) {
+        val next = AtomicInt(0)
+        // Every worker takes the next task until all tasks are taken
+        val futures = workers.take(tasks.size).map { worker ->
+            worker.execute(TransferMode.SAFE, { Job(tasks, next) }) { it.run() }
+        }
+        val errors = futures.map { it.result }
+        errors.firstOrNull { it != null }?.let { throw it }
+    }
+
+    actual fun close() {
+        workers.forEach { it.requestTermination().result }
+    }
+
+    private class Job(val tasks: List<() -> Unit>, val next: AtomicInt) {
+        fun run(): Throwable? {
+            var error: Throwable? = null
+            while (true) {
+                val index = next.addAndGet(1) - 1
+                if (index >= tasks.size) return error
+                try {
+                    tasks[index]()
+                } catch (e: Throwable) {
+                    error = error ?: e
+                }
+            }
+        }
+    }
+}
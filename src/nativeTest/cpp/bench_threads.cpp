@@ -0,0 +1,79 @@
+#include <libdecsync.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stress benchmark for a single DecSync instance shared between threads
+// Usage: bench_threads [threads] [operations per thread] [writers]
+
+void listener(const char** path, const int len, const char* datetime,
+              const char* key, const char* value, void* extra_void) {
+	std::atomic<long>* count = static_cast<std::atomic<long>*>(extra_void);
+	++*count;
+}
+
+int main(int argc, char** argv) {
+	int threads = argc > 1 ? std::atoi(argv[1]) : 8;
+	int operations = argc > 2 ? std::atoi(argv[2]) : 200;
+	int writers = argc > 3 ? std::atoi(argv[3]) : 1;
+
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_bench_threads", "sync-type", nullptr, "app-id");
+	if (error) {
+		std::cout << "Benchmark failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path0[0] {};
+	decsync_add_listener(decsync, path0, 0, listener);
+
+	const int paths = 16;
+	for (int i = 0; i < paths; ++i) {
+		std::string name = "path" + std::to_string(i);
+		const char* path[2] {"bench", name.c_str()};
+		decsync_set_entry(decsync, path, 2, "\"key\"", "\"initial\"");
+	}
+
+	std::atomic<long> readCount {0};
+	std::atomic<long> writeCount {0};
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t) {
+		bool isWriter = t < writers;
+		workers.emplace_back([&, t, isWriter]{
+			for (int i = 0; i < operations; ++i) {
+				std::string name = "path" + std::to_string((t + i) % paths);
+				const char* path[2] {"bench", name.c_str()};
+				if (isWriter) {
+					std::string value = "\"value-" + std::to_string(t) + "-" + std::to_string(i) + "\"";
+					decsync_set_entry(decsync, path, 2, "\"key\"", value.c_str());
+					++writeCount;
+				} else {
+					const char* keys[1] {"\"key\""};
+					decsync_execute_stored_entries_for_path_exact(decsync, path, 2, &readCount, keys, 1);
+				}
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(end - start).count();
+
+	long expectedReads = (long)(threads - std::min(threads, writers)) * operations;
+	if (readCount != expectedReads) {
+		std::cout << "Benchmark failed: read " << readCount << " entries, expected " << expectedReads << std::endl;
+		return 1;
+	}
+
+	std::cout << threads << " threads (" << writers << " writers), " << operations << " operations each" << std::endl;
+	std::cout << "reads: " << readCount << ", writes: " << writeCount << std::endl;
+	std::cout << "time: " << seconds << " s, " << (readCount + writeCount) / seconds << " operations/s" << std::endl;
+	decsync_free(decsync);
+	return 0;
+}
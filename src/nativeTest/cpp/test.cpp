@@ -1,6 +1,14 @@
 #include <libdecsync.h>
+#include <libdecsync.hpp>
+#include <libdecsync_coro.hpp>
+#include <libdecsync_schema.hpp>
 #include <iostream>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <map>
+#include <poll.h>
 #include <string>
 #include <thread>
 #include <vector>
@@ -186,11 +194,592 @@ int test_thread() {
 	return 0;
 }
 
+// Test the asynchronous calls, with the listeners dispatched on this thread
+void on_done(void* done_extra) {
+	++*static_cast<int*>(done_extra);
+}
+
+int test_async() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_async", "sync-type", nullptr, "app-id");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path0[0] {};
+	decsync_add_listener(decsync, path0, 0, listener);
+	decsync_set_async_on_caller_thread(decsync, true);
+
+	int done = 0;
+	const char* path[2] {"foo", "bar"};
+	DecsyncEntryWithPath entryWithPath = decsync_entry_with_path_new(path, 2, "\"key\"", "\"value\"");
+	DecsyncEntryWithPath entriesWithPath[1] {entryWithPath};
+	decsync_set_entries_async(decsync, entriesWithPath, 1, on_done, &done);
+	decsync_entry_with_path_free(entryWithPath);
+
+	Extra extra;
+	DecsyncStoredEntry storedEntry = decsync_stored_entry_new(path, 2, "\"key\"");
+	DecsyncStoredEntry storedEntries[1] {storedEntry};
+	decsync_execute_stored_entries_async(decsync, storedEntries, 1, &extra, on_done, &done);
+	decsync_stored_entry_free(storedEntry);
+
+	struct pollfd fds[1] {{decsync_get_async_fd(decsync), POLLIN, 0}};
+	while (done < 2) {
+		if (poll(fds, 1, 5000) <= 0) {
+			std::cout << "Test failed: async fd not signaled" << std::endl;
+			return 1;
+		}
+		decsync_dispatch_async(decsync);
+	}
+	if (extra[{{"foo", "bar"}, "\"key\""}] != "\"value\"") {
+		std::cout << "Test failed: async stored entry" << std::endl;
+		return 1;
+	}
+
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test whether a failing listener dispatched on this thread keeps its entries, and whether freeing
+// the instance completes the queued calls
+int failures_left = 1;
+
+bool failing_listener(const char** path, const int len, const char* datetime,
+              const char* key, const char* value, void* extra_void) {
+	if (failures_left > 0) {
+		--failures_left;
+		return false;
+	}
+	return listener_with_success(path, len, datetime, key, value, extra_void);
+}
+
+int test_async_success() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_async_success", "sync-type", nullptr, "app-id-1");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path0[0] {};
+	decsync_add_listener_with_success(decsync, path0, 0, failing_listener);
+	decsync_set_async_on_caller_thread(decsync, true);
+
+	Decsync other;
+	decsync_new(&other, ".tests/decsync_async_success", "sync-type", nullptr, "app-id-2");
+	const char* path[2] {"foo", "bar"};
+	decsync_set_entry(other, path, 2, "\"key\"", "\"value\"");
+	decsync_free(other);
+
+	// The first execution fails, so the entry is executed again by the second one
+	Extra extra;
+	struct pollfd fds[1] {{decsync_get_async_fd(decsync), POLLIN, 0}};
+	for (int i = 0; i < 2; ++i) {
+		int done = 0;
+		decsync_execute_all_new_entries_async(decsync, &extra, on_done, &done);
+		while (done < 1) {
+			if (poll(fds, 1, 5000) <= 0) {
+				std::cout << "Test failed: async fd not signaled" << std::endl;
+				return 1;
+			}
+			decsync_dispatch_async(decsync);
+		}
+	}
+	if (failures_left != 0 || extra[{{"foo", "bar"}, "\"key\""}] != "\"value\"") {
+		std::cout << "Test failed: async listener success" << std::endl;
+		return 1;
+	}
+
+	int cancelled = 0;
+	decsync_execute_all_new_entries_async(decsync, &extra, on_done, &cancelled);
+	decsync_execute_all_new_entries_async(decsync, &extra, on_done, &cancelled);
+	decsync_free(decsync);
+	if (cancelled != 2) {
+		std::cout << "Test failed: queued calls not completed by decsync_free" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Test whether the notify fd is signaled by entries of another app
+int test_notify() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_notify", "sync-type", nullptr, "app-id-1");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path0[0] {};
+	decsync_add_listener(decsync, path0, 0, listener);
+	struct pollfd fds[1] {{decsync_get_notify_fd(decsync), POLLIN, 0}};
+
+	Decsync other;
+	decsync_new(&other, ".tests/decsync_notify", "sync-type", nullptr, "app-id-2");
+	const char* path[2] {"foo", "bar"};
+	decsync_set_entry(other, path, 2, "\"key\"", "\"value\"");
+	decsync_free(other);
+
+	if (poll(fds, 1, 5000) <= 0) {
+		std::cout << "Test failed: notify fd not signaled" << std::endl;
+		return 1;
+	}
+	Extra extra;
+	decsync_execute_all_new_entries(decsync, &extra);
+	if (extra[{{"foo", "bar"}, "\"key\""}] != "\"value\"") {
+		std::cout << "Test failed: notified entry" << std::endl;
+		return 1;
+	}
+	if (poll(fds, 1, 0) != 0) {
+		std::cout << "Test failed: notify fd not reset" << std::endl;
+		return 1;
+	}
+
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test whether a locked appId cannot be used by another instance
+int test_lock() {
+	Decsync decsync;
+	int error = decsync_new_with_lock(&decsync, ".tests/decsync_lock", "sync-type", nullptr, "app-id", 0);
+	if (error) {
+		std::cout << "Test failed: decsync_new_with_lock (" << error << ")" << std::endl;
+		return 1;
+	}
+	Decsync other;
+	error = decsync_new_with_lock(&other, ".tests/decsync_lock", "sync-type", nullptr, "app-id", 100);
+	if (error != 3) {
+		std::cout << "Test failed: locked appId used twice (" << error << ")" << std::endl;
+		return 1;
+	}
+	decsync_free(decsync);
+	error = decsync_new_with_lock(&other, ".tests/decsync_lock", "sync-type", nullptr, "app-id", 0);
+	if (error) {
+		std::cout << "Test failed: lock not released (" << error << ")" << std::endl;
+		return 1;
+	}
+	decsync_free(other);
+	return 0;
+}
+
+// Test whether the cached directory listings and keys are used while the files are unchanged
+int test_directory_cache() {
+	namespace fs = std::filesystem;
+	const fs::path dir = ".tests/decsync_cache";
+	const fs::path foo = dir / "sync-type" / "stored-entries" / "app-id" / "foo";
+	const char* path[2] {"foo", "bar"};
+	const char* prefix[1] {"foo"};
+	const char* keys[1] {"\"kez\""};
+	fs::remove_all(dir);
+
+	Decsync decsync;
+	int error = decsync_new(&decsync, dir.c_str(), "sync-type", nullptr, "app-id");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	decsync_set_entry(decsync, path, 2, "\"key\"", "\"value\"");
+	decsync_free(decsync);
+
+	// Recently modified directories and files are not cached, so backdate them
+	const auto old_time = fs::file_time_type::clock::now() - std::chrono::hours(1);
+	for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+		fs::last_write_time(entry.path(), old_time);
+	}
+	decsync_new(&decsync, dir.c_str(), "sync-type", nullptr, "app-id");
+	decsync_add_listener(decsync, prefix, 0, listener);
+	decsync_enable_directory_cache(decsync);
+	Extra extra;
+	decsync_execute_all_stored_entries_for_path_prefix(decsync, prefix, 1, &extra);
+	if (extra[{{"foo", "bar"}, "\"key\""}] != "\"value\"") {
+		std::cout << "Test failed: directory cache (filling)" << std::endl;
+		return 1;
+	}
+	decsync_free(decsync);
+
+	// Change the directory and the file without changing their modification times or sizes, such
+	// that only the cached listing and keys are seen
+	std::ofstream(foo / "baz") << "[\"2020-01-01T00:00:00\",\"key\",\"other\"]\n";
+	std::string text;
+	std::getline(std::ifstream(foo / "bar"), text, '\0');
+	text.replace(text.find("\"key\""), 5, "\"kez\"");
+	std::ofstream(foo / "bar") << text;
+	fs::last_write_time(foo, old_time);
+	fs::last_write_time(foo / "bar", old_time);
+
+	decsync_new(&decsync, dir.c_str(), "sync-type", nullptr, "app-id");
+	decsync_add_listener(decsync, prefix, 0, listener);
+	decsync_enable_directory_cache(decsync);
+	Extra extra_listing;
+	decsync_execute_all_stored_entries_for_path_prefix(decsync, prefix, 1, &extra_listing);
+	if (extra_listing.count({{"foo", "baz"}, "\"key\""}) != 0 || extra_listing.count({{"foo", "bar"}, "\"kez\""}) != 1) {
+		std::cout << "Test failed: directory cache (listing)" << std::endl;
+		return 1;
+	}
+	Extra extra_keys;
+	decsync_execute_stored_entries_for_path_prefix(decsync, prefix, 1, &extra_keys, keys, 1);
+	if (!extra_keys.empty()) {
+		std::cout << "Test failed: directory cache (keys)" << std::endl;
+		return 1;
+	}
+	decsync_free(decsync);
+
+	// Without the cache, the changes are seen
+	decsync_new(&decsync, dir.c_str(), "sync-type", nullptr, "app-id");
+	decsync_add_listener(decsync, prefix, 0, listener);
+	Extra extra_uncached;
+	decsync_execute_stored_entries_for_path_prefix(decsync, prefix, 1, &extra_uncached, keys, 1);
+	decsync_execute_all_stored_entries_for_path_prefix(decsync, prefix, 1, &extra_uncached);
+	if (extra_uncached.count({{"foo", "baz"}, "\"key\""}) != 1 || extra_uncached.count({{"foo", "bar"}, "\"kez\""}) != 1) {
+		std::cout << "Test failed: directory cache (uncached)" << std::endl;
+		return 1;
+	}
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test whether the entries of another app are executed automatically
+int test_auto_sync() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_auto_sync", "sync-type", nullptr, "app-id-1");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path0[0] {};
+	decsync_add_listener(decsync, path0, 0, listener);
+	decsync_set_async_on_caller_thread(decsync, true);
+	Extra extra;
+	decsync_start_auto_sync(decsync, &extra, 100, 1000);
+
+	Decsync other;
+	decsync_new(&other, ".tests/decsync_auto_sync", "sync-type", nullptr, "app-id-2");
+	const char* path[2] {"foo", "bar"};
+	decsync_set_entry(other, path, 2, "\"key\"", "\"value\"");
+	decsync_free(other);
+
+	struct pollfd fds[1] {{decsync_get_async_fd(decsync), POLLIN, 0}};
+	while (extra[{{"foo", "bar"}, "\"key\""}] != "\"value\"") {
+		if (poll(fds, 1, 5000) <= 0) {
+			std::cout << "Test failed: entry not executed automatically" << std::endl;
+			return 1;
+		}
+		decsync_dispatch_async(decsync);
+	}
+
+	decsync_stop_auto_sync(decsync);
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test whether typed entries are written and dispatched to the typed handlers
+struct SchemaHandler {
+	std::map<std::string, bool> read;
+	std::map<std::string, std::optional<std::string>> names;
+
+	void operator()(const decsync::schema::rss::article_read& article, bool value) {
+		if (article.date.year == 2020 && article.date.month == 8 && article.date.day == 23) {
+			read[article.guid] = value;
+		}
+	}
+
+	bool operator()(const decsync::schema::rss::feed_name& feed, const std::optional<std::string>& name) {
+		names[feed.id] = name;
+		return true;
+	}
+};
+
+int test_schema() {
+	namespace rss = decsync::schema::rss;
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_schema", "rss", nullptr, "app-id-1");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	decsync::schema::add_listener<rss::article_read, SchemaHandler>(decsync);
+	decsync::schema::add_listener<rss::feed_name, SchemaHandler>(decsync);
+
+	Decsync other;
+	decsync_new(&other, ".tests/decsync_schema", "rss", nullptr, "app-id-2");
+	decsync::schema::set(other, rss::article_read{{2020, 8, 23}, "guid \"\u263A\""}, true);
+	decsync::schema::set(other, rss::feed_name{"https://example.com/feed"}, std::optional<std::string>("Feed\n"));
+	decsync::schema::set(other, rss::feed_name{"https://example.com/other"}, std::nullopt);
+	decsync_free(other);
+
+	SchemaHandler handler;
+	decsync_execute_all_new_entries(decsync, &handler);
+	if (!handler.read["guid \"\u263A\""] ||
+			handler.names["https://example.com/feed"] != std::optional<std::string>("Feed\n") ||
+			handler.names.count("https://example.com/other") != 1 ||
+			handler.names["https://example.com/other"]) {
+		std::cout << "Test failed: typed schema entries" << std::endl;
+		return 1;
+	}
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test whether the cursor returns the stored entries in path order and can stop early
+int test_cursor() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_cursor", "sync-type", nullptr, "app-id");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path1[2] {"foo", "b"};
+	const char* path2[2] {"foo", "a"};
+	const char* path3[1] {"bar"};
+	decsync_set_entry(decsync, path1, 2, "\"key\"", "\"value1\"");
+	decsync_set_entry(decsync, path2, 2, "\"key\"", "\"value2\"");
+	decsync_set_entry(decsync, path3, 1, "\"key\"", "\"value3\"");
+
+	const char* prefix[1] {"foo"};
+	DecsyncCursor cursor = decsync_cursor_open(decsync, prefix, 1);
+	std::vector<std::string> values;
+	const char** path;
+	int len;
+	const char* datetime;
+	const char* key;
+	const char* value;
+	while (decsync_cursor_next(cursor, &path, &len, &datetime, &key, &value)) {
+		values.push_back(std::string(path[1]) + "=" + value);
+	}
+	decsync_cursor_close(cursor);
+	if (values != std::vector<std::string> {"a=\"value2\"", "b=\"value1\""}) {
+		std::cout << "Test failed: cursor entries" << std::endl;
+		return 1;
+	}
+
+	const char* path0[0] {};
+	cursor = decsync_cursor_open(decsync, path0, 0);
+	if (!decsync_cursor_next(cursor, &path, &len, &datetime, &key, &value) ||
+			len != 1 || std::string(path[0]) != "bar") {
+		std::cout << "Test failed: cursor first entry" << std::endl;
+		return 1;
+	}
+	decsync_cursor_close(cursor);
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test whether the change journal returns the entries stored after a watermark
+int test_changes() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_changes", "sync-type", nullptr, "app-id");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path[2] {"foo", "bar"};
+	long long watermark = decsync_current_changes_watermark(decsync);
+	decsync_set_entry(decsync, path, 2, "\"key\"", "\"value\"");
+
+	Extra extra;
+	watermark = decsync_changes_since(decsync, watermark, listener, &extra);
+	if (extra[{{"foo", "bar"}, "\"key\""}] != "\"value\"") {
+		std::cout << "Test failed: changes since watermark" << std::endl;
+		return 1;
+	}
+	extra.clear();
+	decsync_changes_since(decsync, watermark, listener, &extra);
+	if (!extra.empty()) {
+		std::cout << "Test failed: no changes since new watermark" << std::endl;
+		return 1;
+	}
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test exporting a collection to an archive and importing it into another collection
+int test_archive() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_archive", "sync-type", "collection1", "app-id");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path[2] {"foo", "bar"};
+	decsync_set_entry(decsync, path, 2, "\"key\"", "\"value\"");
+	decsync_free(decsync);
+
+	error = decsync_export_archive(".tests/decsync_archive", "sync-type", "collection1", ".tests/decsync.archive", nullptr);
+	if (error) {
+		std::cout << "Test failed: decsync_export_archive (" << error << ")" << std::endl;
+		return 1;
+	}
+	error = decsync_import_archive(".tests/decsync_archive", "sync-type", "collection2", ".tests/decsync.archive");
+	if (error) {
+		std::cout << "Test failed: decsync_import_archive (" << error << ")" << std::endl;
+		return 1;
+	}
+
+	error = decsync_new(&decsync, ".tests/decsync_archive", "sync-type", "collection2", "app-id");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	Extra extra;
+	const char* path0[0] {};
+	decsync_add_listener(decsync, path0, 0, listener);
+	decsync_execute_stored_entry(decsync, path, 2, "\"key\"", &extra);
+	if (extra[{{"foo", "bar"}, "\"key\""}] != "\"value\"") {
+		std::cout << "Test failed: imported entry" << std::endl;
+		return 1;
+	}
+	decsync_free(decsync);
+	return 0;
+}
+
+// Test the maintenance functions used by decsync-tool
+void count_problem(const char* file, int line, const char* message, void* extra) {
+	++*static_cast<int*>(extra);
+}
+
+int test_maintenance() {
+	Decsync decsync;
+	int error = decsync_new(&decsync, ".tests/decsync_maintenance", "sync-type", nullptr, "app-id");
+	if (error) {
+		std::cout << "Test failed: decsync_new (" << error << ")" << std::endl;
+		return 1;
+	}
+	const char* path[2] {"foo", "bar"};
+	decsync_set_entry(decsync, path, 2, "\"key\"", "\"value1\"");
+	decsync_set_entry(decsync, path, 2, "\"key\"", "\"value2\"");
+	decsync_free(decsync);
+
+	int problems = 0;
+	int count = decsync_maintenance_verify(".tests/decsync_maintenance", "sync-type", nullptr, 2, count_problem, &problems);
+	if (count != 0 || problems != 0) {
+		std::cout << "Test failed: decsync_maintenance_verify (" << count << ")" << std::endl;
+		return 1;
+	}
+	int removed = decsync_maintenance_compact(".tests/decsync_maintenance", "sync-type", nullptr, "app-id", 2);
+	if (removed < 1) {
+		std::cout << "Test failed: decsync_maintenance_compact (" << removed << ")" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Test the C++ wrapper with two instances
+int test_wrapper() {
+	try {
+		decsync::instance decsync(".tests/decsync_wrapper", "sync-type", std::nullopt, "app-id-1");
+		decsync.add_listener({"foo"}, [](const decsync::entry& entry, void* extra_void) {
+			Extra* extra = static_cast<Extra*>(extra_void);
+			Path path(entry.path.begin(), entry.path.end());
+			(*extra)[{path, std::string(entry.key)}] = entry.value;
+		});
+
+		decsync::instance other = decsync::instance(".tests/decsync_wrapper", "sync-type", std::nullopt, "app-id-2");
+		std::vector<std::string> path {"foo", "bar"};
+		other.set_entry(path, "\"key1\"", "\"value1\"");
+		decsync::entries_batch batch;
+		for (int i = 0; i < 2; ++i) {
+			batch.clear();
+			batch.add({"foo", "baz"}, "\"key" + std::to_string(i) + "\"", "\"value2\"");
+			batch.add({"other"}, "\"key3\"", "\"value3\"");
+			other.set_entries(batch);
+		}
+
+		Extra extra;
+		decsync.execute_all_new_entries(&extra);
+		if (extra[{{"bar"}, "\"key1\""}] != "\"value1\"" ||
+				extra[{{"baz"}, "\"key0\""}] != "\"value2\"" ||
+				extra[{{"baz"}, "\"key1\""}] != "\"value2\"" ||
+				extra.size() != 3) {
+			std::cout << "Test failed: wrapper new entries" << std::endl;
+			return 1;
+		}
+
+		extra.clear();
+		decsync::stored_entries_batch stored;
+		stored.add(path, "\"key1\"");
+		decsync.execute_stored_entries(stored, &extra);
+		if (extra[{{"bar"}, "\"key1\""}] != "\"value1\"") {
+			std::cout << "Test failed: wrapper stored entries" << std::endl;
+			return 1;
+		}
+
+		decsync::cursor cursor = other.open_cursor({"foo"});
+		std::optional<decsync::entry> first = cursor.next();
+		if (!first || first->path.size() != 2 || first->path[1] != "bar" || first->value != "\"value1\"") {
+			std::cout << "Test failed: wrapper cursor" << std::endl;
+			return 1;
+		}
+	} catch (const decsync::error& e) {
+		std::cout << "Test failed: " << e.what() << " (" << e.code() << ")" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Coroutine which runs until its first suspension when called, for the coroutine test
+struct detached {
+	struct promise_type {
+		detached get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+detached run_coro(decsync::instance& decsync, decsync::instance& other, decsync::co::entry_batches& batches,
+                  std::vector<decsync::co::owned_entry>& result, bool& done) {
+	decsync::entries_batch batch;
+	batch.add({"foo", "bar"}, "\"key1\"", "\"value1\"");
+	batch.add({"other"}, "\"key2\"", "\"value2\"");
+	co_await decsync::co::set_entries(other, batch);
+	result = co_await batches.next();
+	done = true;
+}
+
+// Test the coroutine interface, resumed on the thread of the caller
+int test_coro() {
+	try {
+		decsync::instance decsync(".tests/decsync_coro", "sync-type", std::nullopt, "app-id-1");
+		decsync::instance other(".tests/decsync_coro", "sync-type", std::nullopt, "app-id-2");
+		decsync::co::entry_batches batches(decsync, {"foo"});
+		decsync_set_async_on_caller_thread(decsync.handle(), true);
+		decsync_set_async_on_caller_thread(other.handle(), true);
+
+		std::vector<decsync::co::owned_entry> result;
+		bool done = false;
+		run_coro(decsync, other, batches, result, done);
+
+		struct pollfd fds[2] {
+			{decsync_get_async_fd(decsync.handle()), POLLIN, 0},
+			{decsync_get_async_fd(other.handle()), POLLIN, 0}
+		};
+		while (!done) {
+			if (poll(fds, 2, 5000) <= 0) {
+				std::cout << "Test failed: coroutine not resumed" << std::endl;
+				return 1;
+			}
+			decsync_dispatch_async(decsync.handle());
+			decsync_dispatch_async(other.handle());
+		}
+		if (result.size() != 1 ||
+				result[0].path != Path {"bar"} ||
+				result[0].key != "\"key1\"" ||
+				result[0].value != "\"value1\"") {
+			std::cout << "Test failed: coroutine entry batch" << std::endl;
+			return 1;
+		}
+	} catch (const decsync::error& e) {
+		std::cout << "Test failed: " << e.what() << " (" << e.code() << ")" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
 int print_result() {
 	std::cout << "Tests successful!" << std::endl;
 	return 0;
 }
 
 int main() {
-	return test_instance() || test_static() || test_thread() || print_result();
+	return test_instance() || test_static() || test_thread() || test_async() || test_async_success() || test_notify() || test_lock() || test_directory_cache() || test_auto_sync() || test_schema() || test_cursor() || test_changes() || test_archive() || test_maintenance() || test_wrapper() || test_coro() || print_result();
 }
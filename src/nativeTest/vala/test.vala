@@ -0,0 +1,51 @@
+// Very basic test of the Vala bindings, mostly to make sure that they compile and link
+
+class Extra {
+	public int calls = 0;
+}
+
+void listener(string[] path, string datetime, string key, string value, Extra extra) {
+	extra.calls++;
+}
+
+int main() {
+	Decsync.Decsync<Extra> decsync;
+	Decsync.Decsync<Extra> other;
+	int error = Decsync.Decsync.@new(out decsync, ".tests/decsync_vala", "sync-type", null, "app-id-1");
+	if (error != 0) {
+		stdout.printf("Test failed: decsync_new (%d)\n", error);
+		return 1;
+	}
+	Decsync.Decsync.@new(out other, ".tests/decsync_vala", "sync-type", null, "app-id-2");
+	decsync.add_listener({}, listener);
+	var source = Decsync.attach_async_source(decsync);
+
+	var extra = new Extra();
+	var loop = new MainLoop();
+	var completed = false;
+	Decsync.set_entries_async.begin(other, {new Decsync.EntryWithPath({"foo", "bar"}, "\"key\"", "\"value\"")}, (obj, res) => {
+		Decsync.set_entries_async.end(res);
+		Decsync.execute_all_new_entries_async.begin(decsync, extra, (obj, res) => {
+			Decsync.execute_all_new_entries_async.end(res);
+			completed = true;
+			loop.quit();
+		});
+	});
+	Timeout.add_seconds(5, () => {
+		loop.quit();
+		return Source.REMOVE;
+	});
+	loop.run();
+	source.destroy();
+
+	if (!completed || extra.calls != 1) {
+		stdout.printf("Test failed: async calls (%d)\n", extra.calls);
+		return 1;
+	}
+	if (Decsync.list_collections(".tests/decsync_vala", "contacts").length != 0) {
+		stdout.printf("Test failed: list_collections\n");
+		return 1;
+	}
+	stdout.printf("Vala tests successful!\n");
+	return 0;
+}
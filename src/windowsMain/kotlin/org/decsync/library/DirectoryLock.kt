@@ -0,0 +1,53 @@
+/**
+ * libdecsync - DirectoryLock.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+import platform.windows.*
+import kotlin.system.getTimeMillis
+
+// Windows cannot lock directories, so a lock file is opened without sharing instead
+internal actual class DirectoryLock(private val handle: HANDLE?) {
+    actual fun release() {
+        CloseHandle(handle)
+    }
+}
+
+internal actual fun lockDirectory(path: String, timeoutMillis: Int): DirectoryLock? {
+    mkdirs(path)
+    val deadline = getTimeMillis() + timeoutMillis
+    while (true) {
+        val handle = CreateFileW(
+                "$path/.decsync-lock",
+                (GENERIC_READ or GENERIC_WRITE).convert(),
+                0u,
+                null,
+                OPEN_ALWAYS.convert(),
+                (FILE_ATTRIBUTE_HIDDEN or FILE_FLAG_DELETE_ON_CLOSE).convert(),
+                null
+        )
+        if (handle != INVALID_HANDLE_VALUE) return DirectoryLock(handle)
+        if (GetLastError() != ERROR_SHARING_VIOLATION.convert<DWORD>()) {
+            throw Exception("Failed to create lock file in $path")
+        }
+        if (timeoutMillis >= 0 && getTimeMillis() >= deadline) return null
+        Sleep(LOCK_RETRY_MILLIS.convert())
+    }
+}
@@ -0,0 +1,28 @@
+/**
+ * libdecsync - DirectoryWatcher.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+// Windows has no file descriptors that can be polled
+internal actual class DirectoryWatcher actual constructor(dir: String, excludedName: String) {
+    actual val fd: Int = -1
+    actual var onChange: (() -> Unit)? = null
+    actual fun reset() {}
+    actual fun dispose() {}
+}
@@ -0,0 +1,44 @@
+/**
+ * libdecsync - MappedFile.kt
+ *
+ * Copyright (C) 2019 Aldo Gunsing
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+package org.decsync.library
+
+import kotlinx.cinterop.*
+import platform.posix.*
+
+// Windows has no mmap, read the file into memory instead
+internal actual fun mapFile(path: String): MappedFile? {
+    val fd = open(path, O_BINARY or O_RDONLY)
+    if (fd < 0) return null
+    val size = memScoped {
+        val fileStat = alloc<stat>()
+        fstat(fd, fileStat.ptr)
+        fileStat.st_size.toInt()
+    }
+    if (size <= 0) {
+        close(fd)
+        return null
+    }
+    val data = nativeHeap.allocArray<ByteVar>(size)
+    readCustom(fd, data, size)
+    close(fd)
+    return MappedFile(data, size) {
+        nativeHeap.free(data)
+    }
+}
@@ -33,6 +33,30 @@ actual fun writeCustom(fd: Int, buf: CValuesRef<*>?, size: Int) {
     write(fd, buf, size.toUInt())
 }
 actual fun gethostnameCustom(name: CValuesRef<ByteVar>, size: Int): Int = gethostname(name, size)
+internal actual fun fileStatCustom(path: String): FileStat? = memScoped {
+    val fileStat = alloc<stat>()
+    if (stat(path, fileStat.ptr) != 0) {
+        null
+    } else {
+        FileStat(fileStat.st_mtime.toLong() * 1_000_000_000L, fileStat.st_size.toLong())
+    }
+}
+// The result of gmtime is thread-local on Windows
+actual fun gmtimeCustom(time: CValuesRef<time_tVar>, result: CValuesRef<tm>): Boolean = memScoped {
+    val tm = gmtime(time)?.pointed ?: return false
+    result.getPointer(this).pointed.apply {
+        tm_sec = tm.tm_sec
+        tm_min = tm.tm_min
+        tm_hour = tm.tm_hour
+        tm_mday = tm.tm_mday
+        tm_mon = tm.tm_mon
+        tm_year = tm.tm_year
+        tm_wday = tm.tm_wday
+        tm_yday = tm.tm_yday
+        tm_isdst = tm.tm_isdst
+    }
+    true
+}
 
 actual fun getDefaultDecsyncDir(): String =
         getenv("DECSYNC_DIR")?.toKString() ?: getenv("USERPROFILE")!!.toKString() + "/DecSync"
\ No newline at end of file